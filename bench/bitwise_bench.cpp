@@ -0,0 +1,102 @@
+/*
+ * File:   bitwise_bench.cpp
+ *
+ * Micro-benchmark of the bit manipulation in bitwise.hpp, on the kernels
+ * that the labelling spends its time in.
+ */
+
+#include "fodge.hpp"
+
+#include <chrono>
+#include <random>
+
+/** The bit counting that bitwise::bitcount did before it used builtins. */
+template<typename B>
+size_t loop_bitcount(B bits){
+    size_t count = 0;
+    for(; bits; count++)
+        bits &= (bits - 1);
+    return count;
+}
+
+/** The bit search that bitwise::unshift did before it used builtins. */
+template<typename B>
+size_t loop_unshift(B shifted){
+    size_t unshifted = 0;
+    for(B b = (shifted >> 1); b; b >>= 1, unshifted++);
+    return unshifted;
+}
+
+/**
+ * @brief The momentum normalisation of Propagator::normalise_mmask, which is
+ * done for three masks of every propagator under every permutation tried.
+ */
+template<size_t (*count)(mmask)>
+mmask normalise(mmask m, int n_mom){
+    mmask last_mask = ((mmask) 1) << (n_mom - 1);
+    int c = count(m);
+    if(c > n_mom/2 || (c == n_mom/2 && (m & last_mask)))
+        m ^= low_momenta(n_mom);
+    return m;
+}
+
+/**
+ * @brief Times a kernel over a set of masks.
+ *
+ * @param name      printed with the result.
+ * @param masks     the masks.
+ * @param kernel    maps a mask to a value that is summed, so that the work
+ *                  cannot be optimised away.
+ * @return the time per mask, in nanoseconds.
+ */
+template<typename Kernel>
+double run(const char* name, const std::vector<mmask>& masks, Kernel kernel){
+    const int n_rounds = 200;
+    size_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < n_rounds; r++){
+        for(mmask m : masks)
+            sum += kernel(m);
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count()
+                / ((double) n_rounds * masks.size());
+    std::cout << "  " << std::left << std::setw(28) << name
+              << std::right << std::setw(8) << std::fixed
+              << std::setprecision(2) << ns << " ns   (" << sum % 10 << ")\n";
+    return ns;
+}
+
+int main(int argc, char** argv){
+    const int n_mom = std::min(argc > 1 ? atoi(argv[1]) : 12,
+                               FODGE_MMASK_BITS);
+
+    //Propagator masks, i.e. random subsets of the momenta
+    std::mt19937_64 rng(1);
+    auto masks = std::vector<mmask>(1 << 16);
+    for(mmask& m : masks)
+        m = (mmask) rng() & low_momenta(n_mom);
+
+    //External leg masks, as met when placing vertices and writing FORM
+    auto legs = std::vector<mmask>(1 << 16);
+    for(mmask& m : legs)
+        m = ((mmask) 1) << (rng() % n_mom);
+
+    std::cout << "Normalising " << n_mom << "-momentum propagators:\n";
+    double t_loop = run("Kernighan loop", masks, [n_mom](mmask m){
+        return normalise<loop_bitcount<mmask>>(m, n_mom);
+    });
+    double t_fast = run("bitwise::bitcount", masks, [n_mom](mmask m){
+        return normalise<bitwise::bitcount<mmask>>(m, n_mom);
+    });
+    std::cout << "  speedup " << t_loop / t_fast << "x\n";
+
+    std::cout << "Finding the index of " << n_mom << "-momentum legs:\n";
+    t_loop = run("shift loop", legs, loop_unshift<mmask>);
+    t_fast = run("bitwise::unshift", legs, bitwise::unshift<mmask>);
+    std::cout << "  speedup " << t_loop / t_fast << "x\n";
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * File:   generator_bench.cpp
+ *
+ * Micro-benchmark of walking permutation groups with the generators in
+ * Generator.hpp, directly, through a virtual interface like the one they
+ * had before, and as ranges.
+ */
+
+#include "fodge.hpp"
+
+#include <chrono>
+#include <memory>
+
+#if PERMUTE_RANGES
+#include <algorithm>
+#include <ranges>
+#endif
+
+/** The interface of the generators before they used static polymorphism,
+ *  with the increment dispatched at run time. */
+class VirtualGenerator {
+public:
+    virtual ~VirtualGenerator() = default;
+    virtual VirtualGenerator& operator++() = 0;
+    virtual explicit operator bool() const = 0;
+    virtual const permute::Permutation& operator*() const = 0;
+};
+
+/** Puts a generator behind @link VirtualGenerator @endlink. */
+template<class G>
+class Virtual : public VirtualGenerator {
+public:
+    Virtual(G gen) : gen(gen) {}
+    Virtual& operator++() override          {   ++gen; return *this;    }
+    explicit operator bool() const override {   return (bool) gen;      }
+    const permute::Permutation& operator*() const override {
+        return *gen;
+    }
+
+private:
+    G gen;
+};
+
+/**
+ * @brief Makes a virtual generator for @f$ Z_R @f$.
+ *
+ * The type is chosen at run time, with a branch that the benchmark never
+ * takes, so that the compiler cannot resolve the calls.
+ */
+std::unique_ptr<VirtualGenerator> make_virtual(const std::vector<int>& R){
+    if(R.empty())
+        return std::unique_ptr<VirtualGenerator>(
+            new Virtual<permute::Sn_Generator>(permute::Sn_Generator(1)));
+    return std::unique_ptr<VirtualGenerator>(
+        new Virtual<permute::ZR_Generator>(permute::ZR_Generator(R)));
+}
+
+/**
+ * @brief Times walks over a group.
+ *
+ * @param name  printed with the result.
+ * @param walk  walks the group once, and returns the number of elements and
+ *              a value that is summed so that the work cannot be optimised
+ *              away.
+ * @return the time per element, in nanoseconds.
+ */
+template<typename Walk>
+double run(const char* name, Walk walk){
+    const int n_rounds = 50;
+    size_t sum = 0, n_elems = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < n_rounds; r++){
+        auto res = walk();
+        n_elems += res.first;
+        sum += res.second;
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count()
+                / (double) n_elems;
+    std::cout << "  " << std::left << std::setw(28) << name
+              << std::right << std::setw(8) << std::fixed
+              << std::setprecision(2) << ns << " ns   (" << sum % 10 << ")\n";
+    return ns;
+}
+
+int main(){
+    const auto splits = std::vector<std::vector<int>>{
+        {6, 6}, {4, 4, 4}, {2, 2, 2, 2, 2}, {2, 2, 3, 3, 3}
+    };
+
+    for(const std::vector<int>& R : splits){
+        std::cout << "Walking Z_R for R = (";
+        for(size_t t = 0; t < R.size(); t++)
+            std::cout << (t ? " " : "") << R[t];
+        std::cout << "):\n";
+
+        double t_virtual = run("virtual operator++", [&R](){
+            auto gen = make_virtual(R);
+            size_t n = 0, sum = 0;
+            do{
+                sum += (**gen).front();
+                n++;
+            } while(++*gen);
+            return std::make_pair(n, sum);
+        });
+        double t_static = run("ZR_Generator", [&R](){
+            permute::ZR_Generator gen(R);
+            size_t n = 0, sum = 0;
+            do{
+                sum += gen->front();
+                n++;
+            } while(++gen);
+            return std::make_pair(n, sum);
+        });
+        run("walk(ZR_Generator)", [&R](){
+            size_t n = 0, sum = 0;
+            for(const permute::Permutation& p
+                    : permute::walk(permute::ZR_Generator(R))){
+                sum += p.front();
+                n++;
+            }
+            return std::make_pair(n, sum);
+        });
+#if PERMUTE_RANGES
+        run("std::ranges::for_each", [&R](){
+            size_t n = 0, sum = 0;
+            std::ranges::for_each(permute::walk(permute::ZR_Generator(R)),
+                [&](const permute::Permutation& p){
+                    sum += p.front();
+                    n++;
+                });
+            return std::make_pair(n, sum);
+        });
+#endif
+        std::cout << "  speedup " << t_virtual / t_static << "x\n";
+    }
+
+    return 0;
+}
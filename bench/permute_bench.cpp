@@ -0,0 +1,87 @@
+/*
+ * File:   permute_bench.cpp
+ *
+ * Micro-benchmark of relabelling momentum masks, comparing
+ * Permutation::permute_bits with a compiled BitPermutation.
+ */
+
+#include "fodge.hpp"
+
+#include <chrono>
+#include <random>
+
+/**
+ * @brief Times the relabelling of a set of labellings.
+ *
+ * @param name      printed with the result.
+ * @param perms     the permutations, one per labelling.
+ * @param masks     the masks of each labelling, as many per labelling as
+ *                  there are masks in all its propagators.
+ * @param relabel   applies a permutation to the masks of a labelling, and
+ *                  returns a value that is summed so that the work cannot be
+ *                  optimised away.
+ * @return the time per labelling, in nanoseconds.
+ */
+template<typename Relabel>
+double run(const char* name, const std::vector<permute::Permutation>& perms,
+           const std::vector<std::vector<mmask>>& masks, Relabel relabel)
+{
+    const int n_rounds = 20;
+    size_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < n_rounds; r++){
+        for(size_t i = 0; i < perms.size(); i++)
+            sum += relabel(perms[i], masks[i]);
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count()
+                / ((double) n_rounds * perms.size());
+    std::cout << "  " << std::left << std::setw(28) << name
+              << std::right << std::setw(8) << std::fixed
+              << std::setprecision(2) << ns << " ns   (" << sum % 10 << ")\n";
+    return ns;
+}
+
+int main(int argc, char** argv){
+    const int n_mom = std::min(argc > 1 ? atoi(argv[1]) : 12,
+                               FODGE_MMASK_BITS);
+    //Three masks per propagator, and a tree diagram has n_mom - 3 of them
+    const int n_masks = 3 * std::max(n_mom - 3, 1);
+
+    std::mt19937_64 rng(1);
+    auto perms = std::vector<permute::Permutation>();
+    auto masks = std::vector<std::vector<mmask>>();
+    auto map = std::vector<size_t>(n_mom);
+    for(int i = 0; i < (1 << 14); i++){
+        std::iota(map.begin(), map.end(), 0);
+        std::shuffle(map.begin(), map.end(), rng);
+        perms.push_back(permute::Permutation(map.begin(), map.end()));
+
+        masks.push_back(std::vector<mmask>(n_masks));
+        for(mmask& m : masks.back())
+            m = (mmask) rng() & low_momenta(n_mom);
+    }
+
+    std::cout << "Relabelling " << n_masks << " masks of " << n_mom
+              << " momenta:\n";
+    double t_loop = run("permute_bits", perms, masks,
+        [](const permute::Permutation& perm, const std::vector<mmask>& ms){
+            size_t sum = 0;
+            for(mmask m : ms)
+                sum += (size_t) perm.permute_bits(m);
+            return sum;
+        });
+    double t_table = run("BitPermutation", perms, masks,
+        [](const permute::Permutation& perm, const std::vector<mmask>& ms){
+            const permute::BitPermutation<mmask> bits(perm);
+            size_t sum = 0;
+            for(mmask m : ms)
+                sum += (size_t) bits(m);
+            return sum;
+        });
+    std::cout << "  speedup " << t_loop / t_table << "x\n";
+
+    return 0;
+}
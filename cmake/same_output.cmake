@@ -0,0 +1,18 @@
+# Runs FODGE with the arguments in ARGS, then again with OPTIONS added, and
+# fails unless both runs print exactly the same thing. Used by ctest, e.g.
+#   cmake -DFODGE=bin/fodge -DARGS="8 10 -d" -DOPTIONS="-j 4" -P same_output.cmake
+separate_arguments(args UNIX_COMMAND "${ARGS}")
+separate_arguments(options UNIX_COMMAND "${OPTIONS}")
+
+execute_process(COMMAND ${FODGE} ${args}
+    OUTPUT_VARIABLE expected RESULT_VARIABLE expected_result)
+execute_process(COMMAND ${FODGE} ${args} ${options}
+    OUTPUT_VARIABLE actual RESULT_VARIABLE actual_result)
+
+if(NOT expected_result EQUAL 0 OR NOT actual_result EQUAL 0)
+    message(FATAL_ERROR "fodge ${ARGS} [${OPTIONS}] failed: "
+        "${expected_result}, ${actual_result}")
+endif()
+if(NOT expected STREQUAL actual)
+    message(FATAL_ERROR "fodge ${ARGS} prints something else with ${OPTIONS}")
+endif()
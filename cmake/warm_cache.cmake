@@ -0,0 +1,32 @@
+# Runs FODGE with the arguments in ARGS and an empty cache directory
+# CACHE_DIR, then again now that the cache is filled, and fails unless the
+# cache was written and both runs print exactly what a run without the cache
+# prints. Used by ctest, e.g.
+#   cmake -DFODGE=bin/fodge -DARGS="8 10 -d" -DCACHE_DIR=cache -P warm_cache.cmake
+separate_arguments(args UNIX_COMMAND "${ARGS}")
+
+file(REMOVE_RECURSE ${CACHE_DIR})
+file(MAKE_DIRECTORY ${CACHE_DIR})
+
+execute_process(COMMAND ${FODGE} ${args}
+    OUTPUT_VARIABLE expected RESULT_VARIABLE expected_result)
+execute_process(COMMAND ${FODGE} ${args} -C ${CACHE_DIR}
+    OUTPUT_VARIABLE cold RESULT_VARIABLE cold_result)
+file(GLOB cache_files ${CACHE_DIR}/*.fdc)
+execute_process(COMMAND ${FODGE} ${args} -C ${CACHE_DIR}
+    OUTPUT_VARIABLE warm RESULT_VARIABLE warm_result)
+
+if(NOT expected_result EQUAL 0 OR NOT cold_result EQUAL 0
+        OR NOT warm_result EQUAL 0)
+    message(FATAL_ERROR "fodge ${ARGS} [-C ${CACHE_DIR}] failed: "
+        "${expected_result}, ${cold_result}, ${warm_result}")
+endif()
+if(NOT cache_files)
+    message(FATAL_ERROR "fodge ${ARGS} wrote nothing to ${CACHE_DIR}")
+endif()
+if(NOT expected STREQUAL cold)
+    message(FATAL_ERROR "fodge ${ARGS} prints something else with a cold cache")
+endif()
+if(NOT expected STREQUAL warm)
+    message(FATAL_ERROR "fodge ${ARGS} prints something else with a warm cache")
+endif()
@@ -0,0 +1,115 @@
+/*
+ * File:   BitPermutation.hpp
+ *
+ * Permutations compiled to lookup tables, for permuting the bits of many
+ * momentum masks by the same permutation.
+ */
+
+#ifndef BITPERMUTATION_H
+#define	BITPERMUTATION_H
+
+#include <cstddef>
+#include <climits>
+#include <cassert>
+#include <vector>
+
+#include "Permutation.hpp"
+
+namespace permute{
+
+/**
+ * @brief A permutation compiled for fast application to the bits of
+ * integers, as done by @link Permutation::permute_bits @endlink.
+ *
+ * Each group of four bits of the input is looked up in a table holding the
+ * permuted bits for all 16 values of the group, and the results are ORed
+ * together. Applying the permutation to a mask of @c n bits thus takes
+ * <tt> n/4 </tt> lookups instead of a step per bit. Building the tables
+ * takes 16 steps per group, which pays off once the permutation is applied
+ * to a few masks. Only the tables of groups that hold bits of the
+ * permutation are stored: inline for up to @c INLINE_GROUPS groups, which
+ * covers every diagram small enough to generate in full, and on the heap
+ * beyond that.
+ *
+ * @tparam B a binary integer type with at least as many bits as the size of
+ *           the permutation.
+ */
+template<typename B>
+class BitPermutation {
+public:
+    /**
+     * @brief Compiles a permutation.
+     *
+     * @param perm  the permutation. It is not referenced after construction.
+     */
+    BitPermutation(const Permutation& perm)
+    : n(perm.size()), n_groups((perm.size() + GROUP_BITS - 1) / GROUP_BITS),
+      heap_tables(n_groups > INLINE_GROUPS ? n_groups * GROUP_SIZE : 0)
+    {
+        assert(n <= CHAR_BIT * sizeof(B));
+
+        for(size_t g = 0; g < n_groups; g++){
+            B* table = tables() + g * GROUP_SIZE;
+            table[0] = 0;
+            for(size_t i = 0; i < GROUP_BITS; i++){
+                size_t idx = g * GROUP_BITS + i;
+                table[1 << i] = idx < n ? ((B) 1) << perm[idx] : (B) 0;
+            }
+            for(size_t v = 3; v < GROUP_SIZE; v++)
+                table[v] = table[v & (v - 1)] | table[v & ~(v - 1)];
+        }
+    }
+
+    /**
+     * @brief Retrieves the size of the permutation.
+     * @return the size.
+     */
+    size_t size() const {   return n;   }
+
+    /**
+     * @brief Applies the permutation to the bits in a binary number.
+     *
+     * @param bits  the number. Only bits below @link BitPermutation::size
+     *              size() @endlink may be set.
+     * @return  the same as <tt> perm.permute_bits(bits) </tt>.
+     */
+    B operator()(B bits) const {
+        const B* table = tables();
+        B res = 0;
+        for(size_t g = 0; g < n_groups && bits; 
+                g++, table += GROUP_SIZE, bits >>= GROUP_BITS)
+            res |= table[(size_t) (bits & (GROUP_SIZE - 1))];
+
+        return res;
+    }
+
+private:
+    /** The number of bits looked up at once. */
+    static constexpr size_t GROUP_BITS = 4;
+    /** The number of entries in a table. */
+    static constexpr size_t GROUP_SIZE = 1 << GROUP_BITS;
+    /** The number of tables stored inline. */
+    static constexpr size_t INLINE_GROUPS = 4;
+
+    /** The tables, one of @c GROUP_SIZE entries per group. */
+    B* tables() {
+        return n_groups > INLINE_GROUPS ? heap_tables.data() : inline_tables;
+    }
+    const B* tables() const {
+        return n_groups > INLINE_GROUPS ? heap_tables.data() : inline_tables;
+    }
+
+    /** The size of the permutation. */
+    size_t n;
+    /** The number of tables. */
+    size_t n_groups;
+    /** The tables if there are at most @c INLINE_GROUPS of them. */
+    B inline_tables[INLINE_GROUPS * GROUP_SIZE];
+    /** The tables if there are more. */
+    std::vector<B> heap_tables;
+};
+
+}
+
+#endif	/* BITPERMUTATION_H */
+
@@ -10,10 +10,13 @@
 #ifndef DIAGRAM_H
 #define	DIAGRAM_H
 
+#include <functional>
+
 #include "permute.hpp"
 
 #include "fodge.hpp"
 #include "DiagramNode.hpp"
+#include "FlatTree.hpp"
 #include "Labelling.hpp"
 #include "Point.hpp"
 
@@ -26,28 +29,65 @@
  */
 class Diagram {
 public:
+    /**
+     * @brief A set of flavour splits that generated diagrams must, or must 
+     * not, have.
+     */
+    struct FlavSplitFilter {
+        /** The flavour splits, each sorted. */
+        std::vector<std::vector<int>> splits;
+        /** If @c true, only diagrams with one of the splits are kept.
+         *  If @c false, those diagrams are removed. */
+        bool include;
+        
+        bool admits(const std::vector<int>& flav_split) const;
+    };
+    
     Diagram();
     Diagram(int order, const std::vector<int>& flav_split);
     Diagram(const Diagram& orig) = default;
+    Diagram(Diagram&& orig) = default;
+    Diagram& operator=(const Diagram& orig) = default;
+    Diagram& operator=(Diagram&& orig) = default;
     virtual ~Diagram() = default;
     
-    bool is_zero();
+    bool is_zero() const;
+    bool stays_zero() const;
+    size_t symmetry_factor() const;
     
     static std::vector<Diagram> generate(int order, int n_legs,
                                          bool singlets, bool traceless_generators = true, 
-                                         bool debug = false);
+                                         bool debug = false,
+                                         const FlavSplitFilter* filter = nullptr);
+    static std::vector<Diagram> generate_bottom_up(int order, int n_legs,
+                                         bool singlets, bool traceless_generators = true, 
+                                         bool debug = false,
+                                         const FlavSplitFilter* filter = nullptr);
+    static std::vector<Diagram> generate_stripped(int order, int n_legs, 
+                                      bool singlets, bool debug = false,
+                                      const FlavSplitFilter* filter = nullptr);
+    static void set_threads(int n);
+    static void set_orderly(bool enable);
+    /** @brief Whether the generation is orderly, see 
+     *  @link Diagram::set_orderly @endlink. */
+    static bool is_orderly()    {   return orderly; }
     std::vector<Diagram> extend(const std::vector<vertex>& new_verts, 
-                                bool singlets, bool debug);
+                                bool singlets, bool debug) const;
+    std::vector<site> extension_sites(bool singlets, bool debug, 
+                                      bool symmetric = false) const;
     void attach(const vertex& new_vert,
                 const std::vector<std::pair<int, int> >& where,
-                std::vector<Diagram>& diagrs, bool singlet, bool debug) const;
+                std::vector<Diagram>& diagrs, bool singlet, bool debug,
+                const FlavSplitFilter* filter = nullptr, 
+                bool ordinary = true) const;
     
     friend bool operator<(const Diagram& d1, const Diagram& d2);
     friend bool operator==(const Diagram& d1, const Diagram& d2);
+    size_t hash() const;
+    void strip();
     
     static size_t filter_flav_split(std::vector<Diagram>& diagrs, 
-                                  const std::vector<std::vector<int>>& filter, 
-                                  bool include);
+                                    const FlavSplitFilter& filter);
     
     friend std::ostream& operator<<(std::ostream& out, const Diagram& d);
     static int summarise(std::ostream& out, const std::vector<Diagram>& diagrs);
@@ -56,14 +96,20 @@ public:
               bool draw_circle = false) const;
     static int TikZ(const std::string& filename, const std::vector<Diagram>& diagrs,
                     int split, double radius, bool draw_circle);
-    static void balance_points(std::unordered_map<mmask, Point>& pts);
+    static void balance_points(std::unordered_map<mmask, Point, mmask_hash>& pts);
     
     void FORM(std::ostream& form, std::map<vertex, int>& verts, int index) const;
     void diagram_name_FORM(std::ostream& form, int index) const;
     static int FORM(const std::string& filename, const std::vector<Diagram>& diagrs);
     
+    void write(std::ostream& out) const;
+    bool read(std::istream& in);
+    
 private:
     friend class Labelling;
+    
+    Diagram(const Diagram& seed, const vertex& new_vert, int split_idx,
+            const std::vector<std::pair<int,int> >& where, bool singlet);
         
     /** The total order (as in O(p^...) ) of the diagram. */
     int order;
@@ -78,12 +124,61 @@ private:
     /** The root node of the tree. */
     DiagramNode root;
     
-    /** All independent flavour-ordered labelings of the legs of the diagram. */
+    /** All independent flavour-ordered labelings of the legs of the diagram,
+     *  sorted so that the first one is canonical. */
     std::vector<Labelling> labellings;
     
+    /** The number of threads used by the generation. */
+    static int n_threads;
+    /** Whether the generation is orderly, see 
+     *  @link Diagram::set_orderly @endlink. */
+    static bool orderly;
+    
     void find_flav_split();
     void index();
-    void label();
+    void label(std::vector<permute::Permutation>* canon = nullptr, 
+               bool all = true);
+    static void label_all(std::vector<Diagram>& diagrs);
+    void visit_labellings(const Labelling& id, 
+                          const std::function<void(Labelling&&)>& visit,
+                          std::vector<permute::Permutation>* syms = nullptr)
+                          const;
+    Labelling canonical(const Labelling& id, 
+                        std::vector<permute::Permutation>* canon) const;
+    
+    void orbit(const Labelling& id, std::vector<Labelling>& lbls) const;
+    void label_slice(const Labelling& id, size_t first, size_t last,
+                     std::vector<Labelling>& lbls) const;
+    bool has_simple_symmetry(const Labelling& id) const;
+    std::vector<permute::Permutation> canonical_perms() const;
+    bool removable(const DiagramNode::LeafVertex& w, const FlatTree& tree) 
+                   const;
+    bool canonical_extension(const std::vector<std::pair<int, int>>& where,
+                             const std::vector<permute::Permutation>& canon) 
+                             const;
+    
+    /** Maps the (order, n_legs) of each subproblem of a generation 
+     *  to its diagrams. */
+    typedef std::map<std::pair<int, int>, const std::vector<Diagram>*> 
+        subproblem_table;
+    
+    static std::vector<std::pair<int, int>> subproblems(int order, int n_legs);
+    static const std::vector<Diagram>& generate_cached(int order, int n_legs,
+                                                       bool singlets, bool debug);
+    static std::vector<Diagram> generate_uncached(int order, int n_legs,
+                                                  bool singlets, 
+                                                  const subproblem_table& subs,
+                                                  bool debug, 
+                                                  bool counting = false,
+                                                  const FlavSplitFilter* filter 
+                                                    = nullptr);
+    static std::vector<Diagram> generate_filtered(int order, int n_legs,
+                                                  bool singlets, 
+                                                  const FlavSplitFilter* filter,
+                                                  bool debug, bool counting);
+    static bool can_reach(const std::vector<int>& flav_split, 
+                          const vertex& new_vert, bool singlet,
+                          const FlavSplitFilter& filter);
         
     static std::vector<Diagram> add_singlets(
             const std::vector<Diagram> diagrs, int order);
@@ -0,0 +1,81 @@
+/*
+ * File:   DiagramCache.hpp
+ *
+ * Implemented in DiagramCache.cpp
+ */
+
+#ifndef DIAGRAMCACHE_H
+#define	DIAGRAMCACHE_H
+
+#include <tuple>
+
+#include "fodge.hpp"
+#include "Diagram.hpp"
+
+/**
+ * @brief Process-wide store of generated diagram sets.
+ *
+ * @link Diagram::generate @endlink recurses over all lower orders and sizes,
+ * and the same (order, legs) subproblem is reached along many different paths.
+ * Every finished set is stored here the first time it is generated and
+ * shared by all later requests for it, for the remainder of the process.
+ *
+ * The stored sets are the raw output of the generation, i.e. sorted and free
+ * of duplicates, but still containing identically zero diagrams other than
+ * those that stay zero (see @link Diagram::stays_zero @endlink).
+ *
+ * If a cache directory is set, every set is also written there in binary
+ * form, and sets missing from memory are looked for there before they are
+ * generated. This lets separate runs share their work. The files are keyed on
+ * order, legs, singlets, generation mode, @c FODGE_VERSION and a format 
+ * number that changes along with the generated sets, and are only valid on 
+ * machines with the same byte order and momentum mask width.
+ */
+class DiagramCache {
+public:
+    /** Identifies a subproblem: (order, n_legs, singlets). */
+    typedef std::tuple<int, int, bool> key;
+
+    static const std::vector<Diagram>* lookup(int order, int n_legs,
+                                              bool singlets);
+    static const std::vector<Diagram>& store(int order, int n_legs,
+                                             bool singlets,
+                                             std::vector<Diagram>&& diagrs);
+    static void clear();
+    
+    static void set_directory(const std::string& dir);
+    static bool on_disk(int order, int n_legs, bool singlets);
+    static bool load(int order, int n_legs, bool singlets, 
+                     std::vector<Diagram>& diagrs);
+    static bool save(int order, int n_legs, bool singlets, 
+                     const std::vector<Diagram>& diagrs);
+
+    /** @brief The number of lookups that found a stored set. */
+    static size_t hits()    {   return n_hits;      }
+    /** @brief The number of lookups that did not find a stored set. */
+    static size_t misses()  {   return n_misses;    }
+    /** @brief The number of sets currently stored. */
+    static size_t size()    {   return sets.size(); }
+
+    static void report(std::ostream& out);
+
+private:
+    /** The stored diagram sets. */
+    static std::map<key, std::vector<Diagram>> sets;
+
+    static size_t n_hits;
+    static size_t n_misses;
+    
+    /** The cache directory, including a trailing slash, or empty if unset. */
+    static std::string directory;
+    /** The number of sets read from and written to the cache directory. */
+    static size_t n_loads;
+    static size_t n_saves;
+    
+    static std::string filename(int order, int n_legs, bool singlets);
+    static bool read_header(std::istream& in, int order, int n_legs, 
+                            bool singlets, size_t& size);
+};
+
+#endif	/* DIAGRAMCACHE_H */
+
@@ -40,14 +40,42 @@
  */
 class DiagramNode {
 public:
+    /**
+     * @brief Describes a vertex that is connected to the rest of the diagram
+     * by a single propagator, and can thus be removed to leave a smaller
+     * diagram.
+     */
+    struct LeafVertex {
+        /** The external legs on the vertex. */
+        mmask momenta;
+        /** The order of the vertex. */
+        int order;
+        /** The number of legs on the vertex, including the propagator. */
+        int n_legs;
+        /** The size of the part of the vertex's flavour split that 
+         *  contains the propagator. */
+        int split;
+        /** Whether the propagator is a singlet. */
+        bool singlet;
+        /** The order of the vertex at the other end of the propagator. */
+        int neighbour_order;
+        /** The location of the vertex, as a traversal like the one given to
+         *  @link DiagramNode::attach @endlink. Empty for the root. */
+        std::vector<std::pair<int, int>> where;
+    };
+    
     DiagramNode();
     DiagramNode(int order, const std::vector<int>& flav_split);
     DiagramNode(int order, const std::vector<int>& flav_split, 
         int split_idx, bool singlet);
     DiagramNode(const DiagramNode& other) = default;
-    virtual ~DiagramNode() = default;
+    DiagramNode(DiagramNode&& other) = default;
+    DiagramNode& operator=(const DiagramNode& other) = default;
+    DiagramNode& operator=(DiagramNode&& other) = default;
+    ~DiagramNode() = default;
     
-    bool is_zero();
+    bool is_zero() const;
+    bool stays_zero() const;
     
     //Methods for determining properties of diagrams
     int find_flav_split(std::vector<int>& flav_split);
@@ -60,34 +88,34 @@ public:
         int parent_order = 0, mmask parent_prev = 0) const;
     
     //Methods for making new diagrams
-    void extend(
-        std::vector<Diagram>& diagrs, const std::vector<vertex>& new_verts,
-        std::unordered_set<int>& idcs, 
-        std::vector<std::pair<int, int> >& traversal, 
-        const Diagram& original, 
-        bool singlet, bool debug);
+    void extension_sites(
+        std::vector<site>& sites, const std::unordered_set<int>& idcs, 
+        std::vector<std::pair<int, int> >& traversal, bool singlet) const;
     void attach(
         const vertex& new_vert, int split_idx,
         const std::vector<std::pair<int,int> >& where, int depth, 
         bool singlet, bool debug);
+    void leaf_vertices(std::vector<LeafVertex>& verts, 
+        std::vector<std::pair<int, int> >& traversal, 
+        int parent_order = 0) const;
        
     
     //Methods for drawing diagrams (implemented in TikZ.cpp)
     bool def_TikZ(const std::vector<Point>& perimeter, int*idx,
-        std::unordered_map<mmask, Point>& points, 
+        std::unordered_map<mmask, Point, mmask_hash>& points, 
         mmask parent_key = 0) const;
     void adjust_TikZ(std::ostream& tikz,
-        std::unordered_map<mmask, Point>& points,
+        std::unordered_map<mmask, Point, mmask_hash>& points,
         double radius, mmask parent_key = 0) const;
     Point draw_TikZ(std::ostream& tikz, 
-        const std::unordered_map<mmask, Point> points, 
+        const std::unordered_map<mmask, Point, mmask_hash> points, 
         mmask parent_key = 0) const;
     void vertex_order_TikZ(std::ostream& tikz, 
-        const std::unordered_map<mmask, Point> points, 
+        const std::unordered_map<mmask, Point, mmask_hash> points, 
         mmask parent_key = 0) const;
     static void compress_points(
-        std::unordered_map<mmask, Point>& points, const Point& ref,
-        mmask key, mmask sub_key, bool incl_parent, 
+        std::unordered_map<mmask, Point, mmask_hash>& points, 
+        const Point& ref, mmask key, mmask sub_key, bool incl_parent, 
         double mid_angle, double compression);
     static Point compress_point(const Point& ref, const Point& pt,
                                 double mid_angle, double compression);
@@ -100,7 +128,12 @@ public:
     static void vertices_FORM(std::ostream& form, std::map<vertex, int>& verts);
     static bool heavy_vertex(const vertex& vert);
     
+    //Methods for binary caching (implemented in Binary.cpp)
+    void write(std::ostream& out) const;
+    bool read(std::istream& in, int depth = 0);
+    
 private:
+    friend class FlatTree;
     
     /** Marks the node as a leaf, i.e external leg. Most other members
      *  are meaningless for a leaf. */
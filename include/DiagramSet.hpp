@@ -0,0 +1,72 @@
+/*
+ * File:   DiagramSet.hpp
+ *
+ * Implemented in DiagramSet.cpp
+ */
+
+#ifndef DIAGRAMSET_H
+#define	DIAGRAMSET_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "fodge.hpp"
+#include "Diagram.hpp"
+
+/**
+ * @brief A thread-safe set of distinct diagrams, used to remove duplicates 
+ * as soon as they are generated.
+ *
+ * Diagrams are hashed with @link Diagram::hash @endlink, which only looks at 
+ * the canonical (first) labelling, and only diagrams with equal hashes are 
+ * compared in full. The set is split into shards with a lock each, so that 
+ * threads inserting different diagrams rarely contend.
+ *
+ * Every diagram is inserted together with its rank, which is its position in 
+ * the order in which a serial generation would produce it. Of several equal 
+ * diagrams, the one with the lowest rank is kept. The contents are therefore 
+ * the same regardless of the number of threads or the order of insertion.
+ * 
+ * A counting set strips the diagrams down to what is needed to tell them 
+ * apart, for when only the number of diagrams of each kind is wanted.
+ */
+class DiagramSet {
+public:
+    /** The position of a diagram in the serial generation order. */
+    typedef uint64_t rank;
+
+    DiagramSet(bool counting = false, size_t n_shards = 64);
+    DiagramSet(const DiagramSet& other) = delete;
+    ~DiagramSet() = default;
+
+    bool insert(Diagram&& d, rank r);
+    std::vector<Diagram> release();
+
+    size_t size() const;
+    /** @brief The number of inserted diagrams that were already present. */
+    size_t duplicates() const   {   return n_duplicates;    }
+
+private:
+    /** A diagram together with its rank. */
+    struct Entry {
+        Diagram diagr;
+        rank r;
+        /** Whether the diagram is identically zero. */
+        bool zero;
+    };
+    /** A part of the set, holding the diagrams whose hashes map to it. */
+    struct Shard {
+        std::mutex lock;
+        std::unordered_multimap<size_t, Entry> entries;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    /** Whether the diagrams are stripped, see 
+     *  @link DiagramSet::DiagramSet @endlink. */
+    bool counting;
+    std::atomic<size_t> n_duplicates;
+};
+
+#endif	/* DIAGRAMSET_H */
+
@@ -0,0 +1,97 @@
+/*
+ * File:   FlatTree.hpp
+ *
+ * Implemented in FlatTree.cpp
+ */
+
+#ifndef FLATTREE_H
+#define	FLATTREE_H
+
+#include <list>
+#include <vector>
+
+#include "fodge.hpp"
+#include "DiagramNode.hpp"
+#include "Propagator.hpp"
+
+/**
+ * @brief A diagram tree stored in flat arrays, for work on short-lived
+ * copies of a @link DiagramNode @endlink tree.
+ *
+ * The nodes and flavour traces are kept in two contiguous arrays of plain
+ * structs, and refer to each other by index instead of owning their
+ * children. The traces of a node are adjacent in the trace array, and the
+ * legs of a trace are adjacent in the node array. Copying a tree is thus two
+ * flat copies instead of one allocation per node and trace, and walking it
+ * does not chase pointers across the heap.
+ *
+ * The tree supports the same analysis as @link DiagramNode @endlink, with
+ * the same results, as well as the removal of a vertex. Nodes that are cut
+ * off from the root are left in the arrays, unused.
+ */
+class FlatTree {
+public:
+    FlatTree(const DiagramNode& root);
+    FlatTree(const FlatTree& other) = default;
+    FlatTree(FlatTree&& other) = default;
+    FlatTree& operator=(const FlatTree& other) = default;
+    FlatTree& operator=(FlatTree&& other) = default;
+    ~FlatTree() = default;
+
+    bool is_zero() const  {   return is_zero(root);  }
+    void find_flav_split(std::vector<int>& flav_split);
+    void index(const std::vector<int>& flav_split);
+    mmask set_momenta()   {   return set_momenta(root);  }
+    void label(std::vector<Propagator>& props, int n_idcs) const;
+
+    void without(const DiagramNode::LeafVertex& w);
+
+private:
+    /** A node, see @link DiagramNode @endlink for the meaning of its
+     *  members. */
+    struct Node {
+        mmask momenta;
+        int order;
+        int n_legs;
+        int connect_idx;
+        /** The index of the first trace of the node. */
+        uint32_t traces;
+        /** The number of traces of the node. */
+        uint32_t n_traces;
+        bool is_leaf;
+        bool is_root;
+        bool is_singlet;
+    };
+
+    /** A flavour trace, see @link DiagramNode @endlink for the meaning of
+     *  its members. */
+    struct Trace {
+        mmask momenta;
+        int n_idcs;
+        /** The index of the first leg of the trace. */
+        uint32_t legs;
+        /** The number of legs of the trace. */
+        uint32_t n_legs;
+        bool connected;
+    };
+
+    /** All nodes, including any that are no longer part of the tree. */
+    std::vector<Node> nodes;
+    /** All flavour traces. */
+    std::vector<Trace> traces;
+    /** The index of the root node. */
+    uint32_t root;
+
+    void flatten(uint32_t idx, const DiagramNode& node);
+
+    bool is_zero(uint32_t idx) const;
+    int find_flav_split(uint32_t idx, std::vector<int>& flav_split);
+    int index(uint32_t idx, std::list<std::pair<int, int>>& flav_split_idcs,
+              int flav_idx = -1);
+    mmask set_momenta(uint32_t idx);
+    void label(uint32_t idx, std::vector<Propagator>& props, int n_idcs,
+               int parent_order, mmask parent_prev) const;
+};
+
+#endif	/* FLATTREE_H */
+
@@ -3,7 +3,7 @@
  * Author: Mattias
  * 
  * Implements group generators as iterators.
- * Definitions implemented in Generator.cpp
+ * Constructors implemented in Generator.cpp
  *
  * Created on 27 June 2019, 16:11
  */
@@ -12,17 +12,44 @@
 #define	GENERATOR_H
 
 #include <vector>
+#include <iterator>
+#include <limits>
+
+#if __cplusplus >= 202002L
+#include <ranges>
+#endif
 
 #include "Permutation.hpp"
 
+/** Whether @link permute::Walk @endlink is a @c std::ranges view. */
+#if defined(__cpp_lib_ranges)
+#define PERMUTE_RANGES 1
+#else
+#define PERMUTE_RANGES 0
+#endif
+
 namespace permute{
 
+/**
+ * @brief Multiplies the orders of two groups.
+ * @return @f$ a b @f$, or 0 if either is 0 or the product does not fit in
+ *      a @c size_t . Orders are never 0, so 0 stands for an order too large
+ *      to count, and stays 0 through further products.
+ */
+inline size_t order_product(size_t a, size_t b){
+    return (b != 0 && a > std::numeric_limits<size_t>::max() / b) ? 0 : a * b;
+}
+
 /**
  * @brief A Generator is an input iterator that produces all elements in a group
  * of permutations. 
  * 
- * This is an abstract class; subclasses implment specific groups
- * and must obey the following properties:
+ * This is a base class template for the curiously recurring template pattern:
+ * a subclass @c G implementing a specific group derives from 
+ * <tt> Generator<G> </tt>, and provides a method @c step that moves to the 
+ * next permutation. Incrementing a generator calls @c step directly, with no
+ * virtual dispatch, so that walking a group can be inlined into the loop 
+ * that uses it. Subclasses must obey the following properties:
  * <ul>
  *  <li> The Generator is initialised so that dereferencing it yields the
  *      identity permutation, and <tt>operator bool</tt> yields 
@@ -38,9 +65,8 @@ namespace permute{
  *      shall be set to @c false upon incrementation.
  * </ul>
  */
-class Generator 
-: public std::iterator<std::input_iterator_tag, Permutation> 
-{
+template<class G>
+class Generator {
 
 public:
     using iterator_category = std::input_iterator_tag;
@@ -49,8 +75,6 @@ public:
     using pointer = value_type const*;
     using difference_type = ptrdiff_t;
 
-    Generator(int n);
-
     /**
      * @brief Converts the Generator to a Boolean value indicating whether it
      * has completed a traversal of its group.
@@ -70,9 +94,23 @@ public:
      */
     pointer operator->() const      {   return &perm;   }
     
-    virtual Generator& operator++() = 0;
+    /**
+     * @brief Moves to the next permutation in the group.
+     * @return the updated generator.
+     */
+    G& operator++() {
+        static_cast<G*>(this)->step();
+        return static_cast<G&>(*this);
+    }
 
 protected:
+    /**
+     * @brief Base constructor: sets up the identity permutation.
+     * @param n the size of the permutation.
+     */
+    Generator(int n) : done(false), perm(n) {}
+    ~Generator() = default;
+
     /** The return value of <tt>operator bool</tt> */
     bool done;
     /** The current permutation */
@@ -83,16 +121,21 @@ protected:
  * @brief A Generator that generates the cyclic group @f$ Z_n @f$ 
  *      of @p n objects.
  */
-class Zn_Generator : public Generator {
+class Zn_Generator : public Generator<Zn_Generator> {
 
 public:
     Zn_Generator(int n = 1);
     Zn_Generator(const Zn_Generator& other) = default;
-    virtual ~Zn_Generator() = default;
+    ~Zn_Generator() = default;
 
-    Zn_Generator& operator++();
+    size_t order() const;
+    size_t rank() const;
+    void seek(size_t rank);
 
 private:
+    friend class Generator<Zn_Generator>;
+    void step();
+    
     /** The order of the group */
     int n;
     /** The number of steps taken so far; when <tt> count == n </tt>, 
@@ -107,17 +150,26 @@ private:
  * It employs the non-recursive Heap's algorithm, which
  * efficiently traverses the set of permutations in such a way that each
  * permutation differs from its predecessor by a single index exchange.
+ * 
+ * The counters of the algorithm are a Lehmer code of the current 
+ * permutation in the order of the traversal, so the generator can be moved
+ * to any permutation by its rank (see @link Sn_Generator::seek @endlink).
  */
-class Sn_Generator : public Generator {
+class Sn_Generator : public Generator<Sn_Generator> {
 
 public:
     Sn_Generator(int n = 1);
     Sn_Generator(const Sn_Generator& other) = default;
-    virtual ~Sn_Generator() = default;
+    ~Sn_Generator() = default;
 
-    Sn_Generator& operator++();
+    size_t order() const;
+    size_t rank() const;
+    void seek(size_t rank);
 
 private:
+    friend class Generator<Sn_Generator>;
+    void step();
+    
     int n;
     
     /** A stack of counters used in the non-recursive form of Heap's algorithm.*/
@@ -136,18 +188,31 @@ private:
  * in @f$ R @f$, under permutations of the set of matrices. The group 
  * combines cyclic permutations within each trace with block-wise exchanges of 
  * the contents of traces that contain equally many matrices.
+ * 
+ * The rank of an element is a mixed-radix number whose digits are the ranks
+ * of the cyclic groups, least significant first, followed by those of the
+ * exchange groups. Any slice of the group can thus be generated by moving 
+ * to the first rank in it with @link ZR_Generator::seek @endlink and 
+ * stepping from there, which allows a traversal to be split into chunks.
+ * Ranks are only defined if the order of the group fits in a @c size_t ;
+ * larger groups can still be walked by stepping.
  */
-class ZR_Generator : public Generator {
+class ZR_Generator : public Generator<ZR_Generator> {
 
 public:
     ZR_Generator(const std::vector<int>& R);
     ZR_Generator(const std::initializer_list<int>& R);
     ZR_Generator(const ZR_Generator& other) = default;
-    virtual ~ZR_Generator() = default;
+    ~ZR_Generator() = default;
 
-    ZR_Generator& operator++();
+    size_t order() const;
+    size_t rank() const;
+    void seek(size_t rank);
 
 private:     
+    friend class Generator<ZR_Generator>;
+    void step();
+    
     /** Lists the cyclic groups associated with all traces (first)
      * and the index at which that trace begins (second) */
     std::vector<std::pair<Zn_Generator, int>> cycl;
@@ -157,6 +222,168 @@ private:
     std::vector<std::pair<Sn_Generator, std::pair<int, int>>> swap;
 };
 
+/**
+ * @brief Cycles the permutation one more step.
+ */
+inline void Zn_Generator::step(){
+    for(size_t i = 0; i + 1 < perm.size(); i++)
+        perm.swap(i, i+1);
+    
+    if(++count >= n){
+        done = true;
+        count %= n;
+    }
+    else
+        done = false;
+}
+
+/**
+ * @brief Visits the next permutation through the non-recursive version of 
+ * Heap's algorithm.
+ * 
+ * Heap's algorithm visits all permutations of @f$ n @f$ elements exactly once and
+ * moves to each new permutation by only exchanging two elements. The algorithm
+ * is recursive in nature and generates all permutations of the first @f$ k-1 @f$
+ * elements before touching the @f$ k @f$ th. Here, we emulate the recursion by
+ * maintaining a stack of counters rather than recursively nested @c for loops. 
+ */
+inline void Sn_Generator::step(){
+    stack_idx = 0;
+    while(stack_idx < n){
+        if(ctr_stack[stack_idx] < stack_idx){
+            if(stack_idx % 2)
+                perm.swap(ctr_stack[stack_idx], stack_idx);
+            else
+                perm.swap(0, stack_idx);
+            
+            ctr_stack[stack_idx]++;
+            
+            done = false;
+            return;
+        }
+        else{
+            ctr_stack[stack_idx] = 0;
+            stack_idx++;
+        }
+    }
+    
+    //Heap's algorithm ends on a permutation other than the identity
+    perm = Permutation(n);
+    done = true;
+}
+
+/**
+ * @brief Visits the next permutation by updating the subcomponent groups in turn.
+ */
+inline void ZR_Generator::step(){
+    done = false;
+    
+    //Cyclings first...
+    for(auto& c : cycl){
+        (*(c.first)).inverse().permute(perm, c.second);
+        if(++(c.first)){
+            (*(c.first)).permute(perm, c.second);
+            return;
+        }        
+    }
+    //...then swaps.
+    for(auto& s : swap){
+        (*(s.first)).inverse().permute(perm, s.second.first, s.second.second);
+        if(++(s.first)){
+            (*(s.first)).permute(perm, s.second.first, s.second.second);
+            return;
+        }
+    }
+    
+    //Only if all subcomponents are done are we done.
+    done = true;
+}
+
+/**
+ * @brief Adapts a Generator to a range of the permutations in its group, for
+ * use in range-based @c for loops and, from C++20, with @c std::ranges.
+ * 
+ * The range is single-pass: it starts at the permutation the generator is on
+ * and ends when the generator has completed its traversal. The generator is
+ * then back at the identity, as after initialisation.
+ * 
+ * @tparam G    a @link Generator @endlink type.
+ */
+template<class G>
+class Walk
+#if PERMUTE_RANGES
+: public std::ranges::view_interface<Walk<G>>
+#endif
+{
+public:
+    /** @brief An input iterator over the permutations. */
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using iterator_concept = std::input_iterator_tag;
+        using value_type = Permutation;
+        using reference = value_type const&;
+        using pointer = value_type const*;
+        using difference_type = ptrdiff_t;
+        
+        /** @brief Constructs the end iterator. */
+        iterator() : gen(nullptr) {}
+        /** @brief Constructs an iterator at the current permutation of 
+         *  @p gen . */
+        explicit iterator(G* gen) : gen(gen) {}
+        
+        reference operator*() const     {   return **gen;   }
+        pointer operator->() const      {   return &**gen;  }
+        iterator& operator++()          {   ++*gen; return *this;   }
+        void operator++(int)            {   ++*gen; }
+        
+        /** @brief Compares iterators, which are equal when both are at the 
+         *  end. Iterators that are not at the end are only compared to the 
+         *  end iterator. */
+        friend bool operator==(const iterator& it1, const iterator& it2){
+            return it1.at_end() == it2.at_end();
+        }
+        friend bool operator!=(const iterator& it1, const iterator& it2){
+            return !(it1 == it2);
+        }
+        
+    private:
+        bool at_end() const {   return !gen || !*gen;   }
+        
+        /** The generator, or @c nullptr for the end iterator. */
+        G* gen;
+    };
+    
+    /**
+     * @brief Constructs a walk over a generator.
+     * @param gen   the generator, which is moved into the walk.
+     */
+    explicit Walk(G gen) : gen(std::move(gen)) {}
+    
+    iterator begin()    {   return iterator(&gen);  }
+    iterator end()      {   return iterator();      }
+    
+private:
+    G gen;
+};
+
+/**
+ * @brief Walks the group of a generator, as in 
+ * <tt> for(const Permutation& p : walk(Sn_Generator(4))) </tt>.
+ * 
+ * @param gen   the generator.
+ * @return  a range over the permutations in its group.
+ */
+template<class G>
+Walk<G> walk(G gen){
+    return Walk<G>(std::move(gen));
+}
+
+#if PERMUTE_RANGES
+static_assert(std::ranges::input_range<Walk<ZR_Generator>>);
+static_assert(std::ranges::view<Walk<ZR_Generator>>);
+#endif
+
 }
 
 #endif	/* GENERATOR_H */
@@ -38,18 +38,36 @@ public:
     Labelling() = default;
     Labelling (DiagramNode& root, int n_legs);
     Labelling (const Labelling& orig) = default;
+    Labelling (Labelling&& orig) = default;
+    Labelling& operator=(const Labelling& orig) = default;
+    Labelling& operator=(Labelling&& orig) = default;
     Labelling (const Labelling& orig, const permute::Permutation& cycl);
+    Labelling (const permute::Permutation& perm, 
+        std::vector<Propagator>&& props);
     virtual ~Labelling() = default;
     
     friend bool operator<(const Labelling& l1, const Labelling& l2);
     friend bool operator==(const Labelling& l1, const Labelling& l2);
+    size_t hash() const     {   return hash(props); }
+    static size_t hash(const std::vector<Propagator>& props);
+    
+    void relabel(const permute::Permutation& cycl, 
+        std::vector<Propagator>& props) const;
+    void rotate(size_t offs, size_t len, size_t steps);
+    bool has_props(const std::vector<Propagator>& props) const;
     
     friend std::ostream& operator<<(std::ostream& out, const Labelling& l);
     void print_header(std::ostream& out) const;
     
     permute::Permutation index_locations() const;
+    /** @brief The permutation giving this labelling from the identity. */
+    const permute::Permutation& permutation() const {   return perm;    }
+    static Labelling identity(const DiagramNode& root, int n_legs);
     
     void FORM(std::ostream& form) const;
+    
+    void write(std::ostream& out) const;
+    bool read(std::istream& in);
 
 private:
     void normalise();
@@ -9,13 +9,21 @@
 #define	PERMUTATION_H
 
 #include <cstddef>
+#include <cstdint>
 #include <cassert>
 
 #include <vector>
+#include <iterator>
 #include <numeric>
 #include <algorithm>
 #include <iostream>
 
+/** The largest size of a permutation, which is stored inline rather than 
+ *  on the heap. At most 255. */
+#ifndef PERMUTE_CAPACITY
+#define PERMUTE_CAPACITY 32
+#endif
+
 namespace permute{
 
 /**
@@ -27,12 +35,19 @@ namespace permute{
  * 
  * The action of the permutation on a list of objects is to map the ith object 
  * to the jth one, where j is the ith index in the array.
+ * 
+ * The array has a fixed capacity of @c PERMUTE_CAPACITY one-byte indices and
+ * is stored inside the object, so permutations are created, copied and 
+ * composed without allocating. 
  */
 class Permutation {
 public:    
     Permutation(size_t size = 1);
     Permutation(const Permutation& orig) = default;
-    virtual ~Permutation() = default;
+    Permutation(Permutation&& orig) = default;
+    Permutation& operator=(const Permutation& orig) = default;
+    Permutation& operator=(Permutation&& orig) = default;
+    ~Permutation() = default;
     
     Permutation(std::initializer_list<size_t> list);
     
@@ -52,10 +67,10 @@ public:
      * @param end   an iterator past the end of the range.
      */
     template<class ForwardIt>
-    Permutation(ForwardIt begin, ForwardIt end) : map() {
-        map.reserve(std::distance(begin, end));
+    Permutation(ForwardIt begin, ForwardIt end) : len(0) {
+        assert(std::distance(begin, end) <= PERMUTE_CAPACITY);
         for(auto it = begin; it != end; ++it)
-            map.push_back(*it);
+            map[len++] = (index_type) *it;
     }
     
     static Permutation identity(size_t size);
@@ -95,7 +110,12 @@ public:
      * @brief Retrieves the size of the permutation, i.e. how many objects it permutes.
      * @return the size.
      */
-    size_t size() const { return map.size();  }
+    size_t size() const { return len;  }
+    /**
+     * @brief Retrieves the largest size that a permutation can have.
+     * @return @c PERMUTE_CAPACITY.
+     */
+    static size_t max_size() { return PERMUTE_CAPACITY; }
     size_t order() const;
       
     bool is_identity() const;
@@ -104,8 +124,11 @@ public:
     std::vector<size_t> cycle_type() const; 
     std::vector<size_t> fixed_points() const;
     
-    typedef std::vector<size_t>::const_iterator            iterator;
-    typedef std::vector<size_t>::const_reverse_iterator    reverse_iterator;
+    /** The type of the stored indices. */
+    typedef uint8_t index_type;
+    
+    typedef const index_type*                       iterator;
+    typedef std::reverse_iterator<iterator>         reverse_iterator;
     
     /**
      * @brief Iterator to the beginning of the permutation.
@@ -114,7 +137,7 @@ public:
      * In order to avoid invalidating the permutation, all iterators
      * to permutations are constant iterators.
      */
-    iterator begin() const          {   return map.cbegin();   }
+    iterator begin() const          {   return map;            }
     /**
      * @brief Iterator to the end of the permutation.
      * @return a const iterator.
@@ -122,7 +145,7 @@ public:
      * In order to avoid invalidating the permutation, all iterators
      * to permutations are constant iterators.
      */
-    iterator end() const            {   return map.cend();     }
+    iterator end() const            {   return map + len;      }
     /**
      * @brief Reverse iterator to the beginning of the permutation.
      * @return a const iterator.
@@ -130,7 +153,7 @@ public:
      * In order to avoid invalidating the permutation, all iterators
      * to permutations are constant iterators.
      */
-    reverse_iterator rbegin() const {   return map.crbegin();  }
+    reverse_iterator rbegin() const {   return reverse_iterator(end());    }
     /**
      * @brief Reverse iterator to the end of the permutation.
      * @return a const iterator.
@@ -138,7 +161,7 @@ public:
      * In order to avoid invalidating the permutation, all iterators
      * to permutations are constant iterators.
      */
-    reverse_iterator rend() const   {   return map.crend();    }
+    reverse_iterator rend() const   {   return reverse_iterator(begin());  }
     
     /**
      * @brief The first index in the permutation.
@@ -147,7 +170,7 @@ public:
      * In order to avoid invalidating the permutation, all iterators
      * to permutations are constant iterators.
      */
-    size_t front() const            {   return map.front();    }
+    size_t front() const            {   return map[0];         }
     /**
      * @brief The last index in the permutation.
      * @return a copy of the index.
@@ -155,13 +178,16 @@ public:
      * In order to avoid invalidating the permutation, all iterators
      * to permutations are constant iterators.
      */
-    size_t back() const             {   return map.back();     }
+    size_t back() const             {   return map[len - 1];   }
     /**
      * @brief Retrieves an index in the permutation.
      * @param i a value in the range [0, size() ).
      * @return a copy of the ith index.
      */
-    size_t operator[] (size_t i) const { return map.at(i);     }
+    size_t operator[] (size_t i) const { 
+        assert(i < len);
+        return map[i];
+    }
     
     /**
      * @brief Applies a permutation to a collection of objects.
@@ -185,7 +211,7 @@ public:
             size_t offset = 0, size_t block_len = 1) const
     {
         auto it = iter + offset;
-        for(size_t i = 0, j; i < map.size(); i++){
+        for(size_t i = 0, j; i < len; i++){
             j = map[i];
             while(j < i)
                 j = map[j];
@@ -224,13 +250,16 @@ public:
      * @param block_len If provided, the permutation will be applied to blocks
      *                  of this many bits rather than to individual bits.
      * @return  the permuted number.
+     * 
+     * To apply the same permutation to many numbers, compile it into a
+     * @link BitPermutation @endlink instead.
      */
     template<typename B>
     B permute_bits (B bits, size_t offset = 0, size_t block_len = 1) const {
         B one = (B) 1;
-        B mask = one << block_len - one;
+        B mask = (one << block_len) - one;
         
-        B res = bits & ((one << offset) - one);
+        B res = bits & ((one << offset * block_len) - one);
         bits >>= offset * block_len;
         for(size_t idx = 0; bits; bits >>= block_len, idx++){
             res |= (bits & mask) << (map[idx] + offset) * block_len;
@@ -282,9 +311,9 @@ public:
                     };
         
         if(require_stable)
-            std::stable_sort(sort.map.begin(), sort.map.end(), comparator);
+            std::stable_sort(sort.map, sort.map + sort.len, comparator);
         else
-            std::sort(sort.map.begin(), sort.map.end(), comparator);
+            std::sort(sort.map, sort.map + sort.len, comparator);
         
         return sort;
     }
@@ -308,9 +337,9 @@ public:
                     };
         
         if(require_stable)
-            std::stable_sort(sort.map.begin(), sort.map.end(), comparator);
+            std::stable_sort(sort.map, sort.map + sort.len, comparator);
         else
-            std::sort(sort.map.begin(), sort.map.end(), comparator);
+            std::sort(sort.map, sort.map + sort.len, comparator);
         
         return sort;
     }
@@ -336,9 +365,13 @@ public:
     friend std::ostream& operator<< (std::ostream& out, const Permutation& p);
     
 private:
-    std::vector<size_t> map;
+    static_assert(PERMUTE_CAPACITY <= 255, 
+        "permutation sizes must fit in an index_type");
     
-    Permutation(std::vector<size_t>& perm);
+    /** The indices. Only the first @c len are meaningful. */
+    index_type map[PERMUTE_CAPACITY];
+    /** The size of the permutation. */
+    index_type len;
 };
 
 }
@@ -28,6 +28,13 @@
  * this information is supplied by this class. Importantly, momenta are normalised
  * to a canonical form under conservation of momentum so that well-defined
  * comparisons can be made.
+ *
+ * Propagators are compared and sorted in bulk whenever a labelling is made,
+ * so they are stored as a packed key rather than field by field. The vertex
+ * orders and the three masks are laid out in the key from most to least
+ * significant in the order in which they are compared, which makes the
+ * comparison a comparison of integers. With masks of up to 32 bits, the key
+ * is a single 64- or 128-bit integer.
  */
 class Propagator {
 public:
@@ -39,35 +46,70 @@ public:
         int src_order, mmask src_prev, 
         int dst_order, mmask dst_prev);
     Propagator(const Propagator& orig) = default;
-    Propagator(const Propagator& orig, const permute::Permutation& cycl);
-    virtual ~Propagator() = default;
+    Propagator(const Propagator& orig, 
+        const permute::BitPermutation<mmask>& cycl);
+    ~Propagator() = default;
+    
+    void rotate(size_t offs, size_t len, size_t steps);
     
     friend bool operator<(const Propagator& p1, const Propagator& p2);
     friend bool operator==(const Propagator& p1, const Propagator& p2);
+    size_t hash() const;
     
     friend std::ostream& operator<<(std::ostream& out, const Propagator& p);
     void print_header(std::ostream& out) const;
     
     void FORM(std::ostream& form, mmask prop) const;
+    
+    void write(std::ostream& out) const;
+    bool read(std::istream& in);
 
 private:    
-    void normalise();
+    /** The integer type that the key is made of: the narrowest that holds 
+     *  the whole key, or a mask if there is none. */
+#if FODGE_MMASK_BITS <= 16
+    typedef uint64_t key_word;
+#elif FODGE_MMASK_BITS <= 32 && defined(__SIZEOF_INT128__)
+    typedef unsigned __int128 key_word;
+#else
+    typedef mmask key_word;
+#endif
+    
+    /** The slots of the key, from most to least significant. */
+    enum { ORDERS, SRC_PREV, DST_PREV, MOMENTA, N_SLOTS };
+    /** The number of slots, each as wide as a mask, held by a key word. */
+    static constexpr int SLOTS_PER_WORD = sizeof(key_word) / sizeof(mmask);
+    /** The number of words in the key. */
+    static constexpr int KEY_WORDS = N_SLOTS / SLOTS_PER_WORD;
+    
+    void pack(mmask momenta, int src_order, mmask src_prev, 
+        int dst_order, mmask dst_prev);
+    void normalise(mmask momenta, int src_order, mmask src_prev, 
+        int dst_order, mmask dst_prev);
     mmask normalise_mmask(mmask m, mmask last_mask, mmask all_mask) const;
-
-    /** Bitmask storing the momentum indices carried by the propagator. */
-    mmask momenta;
-    /** Total number of momenta in the containing diagram. */
-    int n_mom;
     
+    /** Reads a slot of the key. */
+    mmask slot(int s) const {
+        return (mmask) (key[s / SLOTS_PER_WORD] 
+            >> ((SLOTS_PER_WORD - 1 - s % SLOTS_PER_WORD) * FODGE_MMASK_BITS));
+    }
+    
+    /** Bitmask storing the momentum indices carried by the propagator. */
+    mmask momenta() const   {   return slot(MOMENTA);   }
     /** Order of the "source" vertex (momentum flowing out) */
-    int src_order;
+    int src_order() const   {   return (int) (slot(ORDERS) >> 8);   }
     /** Momenta carried by adjacent vertex leg at source, used by singlets */
-    mmask src_prev;
+    mmask src_prev() const  {   return slot(SRC_PREV);  }
     /** Order of the "destination" vertex (momentum flowing in) */
-    int dst_order;
+    int dst_order() const   {   return (int) (slot(ORDERS) & 0xff); }
     /** Momenta carried by adjacent vertex leg at dest, used by singlets */
-    mmask dst_prev;
+    mmask dst_prev() const  {   return slot(DST_PREV);  }
+
+    /** The packed orders and masks. */
+    key_word key[KEY_WORDS];
+    /** Total number of momenta in the containing diagram. Not part of the
+     *  key, since it is the same for all propagators that are compared. */
+    uint8_t n_mom;
 };
 
 #endif	/* PROPAGATOR_H */
-
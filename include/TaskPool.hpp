@@ -0,0 +1,70 @@
+/*
+ * File:   TaskPool.hpp
+ *
+ * Implemented in TaskPool.cpp
+ */
+
+#ifndef TASKPOOL_H
+#define	TASKPOOL_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief A work-stealing pool of threads for running many small,
+ * unevenly sized tasks.
+ *
+ * Each worker thread owns a double-ended queue of tasks. It takes work from
+ * the back of its own queue, so that tasks spawned by a task are run by the
+ * same thread while their data is still fresh. A worker whose queue runs dry
+ * steals from the front of the other queues, which is where the oldest and
+ * typically largest tasks are.
+ *
+ * Tasks can spawn further tasks with @link TaskPool::spawn @endlink, and
+ * @link TaskPool::run @endlink returns once all tasks, including spawned
+ * ones, have finished. Tasks must not throw.
+ */
+class TaskPool {
+public:
+    /** A unit of work. */
+    typedef std::function<void()> task;
+
+    TaskPool(int n_threads);
+    TaskPool(const TaskPool& other) = delete;
+    ~TaskPool() = default;
+
+    void spawn(task t);
+    void run();
+
+    /** @brief The number of worker threads. */
+    int size() const    {   return (int) queues.size(); }
+    /** @brief The number of tasks that were stolen during the last run. */
+    size_t steals() const   {   return n_steals;    }
+
+private:
+    /** A queue of tasks, owned by one worker. */
+    struct TaskQueue {
+        std::mutex lock;
+        std::deque<task> tasks;
+    };
+
+    /** The task queue of each worker. */
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    /** The number of tasks spawned but not yet finished. */
+    std::atomic<size_t> n_pending;
+    /** The number of tasks that were taken from another worker's queue. */
+    std::atomic<size_t> n_steals;
+    /** The queue that receives the next task spawned from outside the pool. */
+    size_t next_queue;
+
+    bool pop(size_t worker, task& t);
+    bool steal(size_t worker, task& t);
+    void work(size_t worker);
+};
+
+#endif	/* TASKPOOL_H */
+
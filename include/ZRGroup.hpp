@@ -0,0 +1,84 @@
+/*
+ * File:   ZRGroup.hpp
+ *
+ * Implemented in ZRGroup.cpp
+ */
+
+#ifndef ZRGROUP_H
+#define	ZRGROUP_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "fodge.hpp"
+
+/**
+ * @brief The group @f$ Z_R @f$ of a flavour split @f$ R @f$, laid out for
+ * labelling diagrams.
+ *
+ * @f$ Z_R @f$ is generated by the rotations of each trace and the exchanges
+ * of traces of equal length. Labelling a diagram needs the layout of its
+ * traces, a set of generators and the order of the group, all of which
+ * depend on the flavour split alone. Generated sets have thousands of
+ * diagrams but only a handful of flavour splits, so each group is built
+ * once per process and shared by all diagrams with its flavour split.
+ * Groups are looked up for every diagram, from several threads at once, 
+ * so a group that has been built is found without taking a lock.
+ *
+ * The elements of the group are not stored. Diagrams with symmetries need
+ * only part of the group, and @link Diagram::visit_labellings @endlink
+ * builds the elements it needs from the layout.
+ */
+class ZRGroup {
+public:
+    static const ZRGroup& of(const std::vector<int>& flav_split);
+
+    /** @brief The number of traces. */
+    size_t n_traces() const     {   return offs.size();     }
+    /** @brief The index at which trace @p t begins. */
+    int offset(size_t t) const  {   return offs[t];         }
+    /** @brief The first trace that is as long as trace @p t . */
+    size_t row(size_t t) const  {   return rows[t];         }
+    /** @brief The number of elements in the group, or 0 if it does not
+     *  fit in a @c size_t . */
+    size_t order() const        {   return zr_order;        }
+    /** @brief The rotation of each trace by one step, and the exchange of
+     *  each pair of neighbouring traces of equal length. */
+    const std::vector<permute::Permutation>& generators() const {
+        return gens;
+    }
+
+    permute::Permutation element(const std::vector<size_t>& dest,
+                                 const std::vector<int>& rot) const;
+
+private:
+    ZRGroup(const std::vector<int>& flav_split);
+    ZRGroup(const ZRGroup& other) = delete;
+    
+    /** A group that has been built, linked to the one built before it. */
+    struct Entry;
+
+    /** The flavour split. */
+    std::vector<int> flav_split;
+    /** The total number of indices. */
+    int n_idcs;
+    /** See @link ZRGroup::offset @endlink. */
+    std::vector<int> offs;
+    /** See @link ZRGroup::row @endlink. */
+    std::vector<size_t> rows;
+    /** See @link ZRGroup::generators @endlink. */
+    std::vector<permute::Permutation> gens;
+    /** See @link ZRGroup::order @endlink. */
+    size_t zr_order;
+
+    /** The group built last, which links to all groups built so far. 
+     *  Entries are never changed or removed once published here, so they 
+     *  can be read without a lock and references to them stay valid. */
+    static std::atomic<const Entry*> groups;
+    /** Serialises the building of groups. */
+    static std::mutex lock;
+};
+
+#endif	/* ZRGROUP_H */
+
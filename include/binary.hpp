@@ -0,0 +1,148 @@
+/**
+ * @file
+ * File:   binary.hpp
+ *
+ * Utility templates for compact binary input and output.
+ */
+
+#ifndef BINARY_H
+#define	BINARY_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace binary {
+
+/** The largest size that @link binary::write_size @endlink can write. */
+constexpr size_t MAX_SIZE = UINT32_MAX;
+
+/**
+ * @brief Writes the raw bytes of a plain value to a stream.
+ *
+ * The value is written in the byte order of the host, so the output is only
+ * meant to be read back on the same kind of machine.
+ *
+ * @tparam T    a trivially copyable type.
+ * @param out   the stream.
+ * @param val   the value.
+ */
+template<typename T>
+void write(std::ostream& out, const T& val){
+    out.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+/**
+ * @brief Reads a plain value written by @link binary::write @endlink.
+ *
+ * @tparam T    a trivially copyable type.
+ * @param in    the stream. If it fails or runs out, its fail bit is set and
+ *              the returned value is meaningless.
+ * @return  the value.
+ */
+template<typename T>
+T read(std::istream& in){
+    T val = T();
+    in.read(reinterpret_cast<char*>(&val), sizeof(T));
+    return val;
+}
+
+/**
+ * @brief Writes a container size in the fixed-width form used by the
+ * vector and string overloads.
+ *
+ * @param out   the stream.
+ * @param size  the size. If it is larger than @c MAX_SIZE , nothing is
+ *              written and the fail bit of @p out is set.
+ */
+inline void write_size(std::ostream& out, size_t size){
+    if(size > MAX_SIZE){
+        out.setstate(std::ios::failbit);
+        return;
+    }
+    write(out, (uint32_t) size);
+}
+
+/**
+ * @brief Reads a container size written by @link binary::write_size @endlink.
+ *
+ * @param in    the stream.
+ * @param limit the largest size accepted. Anything larger is taken as a sign of
+ *              corrupted input, and sets the fail bit of @p in . Sizes that
+ *              can grow with the output, rather than with the number of
+ *              legs, should pass @c MAX_SIZE .
+ * @return  the size, or 0 on failure.
+ */
+inline size_t read_size(std::istream& in, size_t limit){
+    size_t size = read<uint32_t>(in);
+    if(!in || size > limit){
+        in.setstate(std::ios::failbit);
+        return 0;
+    }
+    return size;
+}
+
+/**
+ * @brief Writes a vector of plain values, preceded by its size.
+ *
+ * @tparam T    a trivially copyable type.
+ * @param out   the stream.
+ * @param vec   the vector.
+ */
+template<typename T>
+void write(std::ostream& out, const std::vector<T>& vec){
+    write_size(out, vec.size());
+    for(const T& t : vec)
+        write(out, t);
+}
+
+/**
+ * @brief Reads a vector written by the corresponding overload of
+ * @link binary::write @endlink.
+ *
+ * @tparam T    a trivially copyable type.
+ * @param in    the stream.
+ * @param vec   the vector, whose previous contents are replaced.
+ * @param limit the largest size accepted, see @link binary::read_size 
+ *              @endlink.
+ */
+template<typename T>
+void read(std::istream& in, std::vector<T>& vec, size_t limit = MAX_SIZE){
+    vec.clear();
+    size_t size = read_size(in, limit);
+    for(size_t i = 0; i < size && in; i++)
+        vec.push_back(read<T>(in));
+}
+
+/**
+ * @brief Writes a string, preceded by its size.
+ *
+ * @param out   the stream.
+ * @param str   the string.
+ */
+inline void write(std::ostream& out, const std::string& str){
+    write_size(out, str.size());
+    out.write(str.data(), str.size());
+}
+
+/**
+ * @brief Reads a string written by the corresponding overload of
+ * @link binary::write @endlink.
+ *
+ * @param in    the stream.
+ * @param str   the string, whose previous contents are replaced.
+ * @param limit the largest size accepted, see @link binary::read_size 
+ *              @endlink. The string is allocated before it is read, so 
+ *              this should be no larger than needed.
+ */
+inline void read(std::istream& in, std::string& str, size_t limit){
+    str.assign(read_size(in, limit), '\0');
+    if(!str.empty())
+        in.read(&str[0], str.size());
+}
+
+}
+
+#endif	/* BINARY_H */
+
@@ -12,59 +12,199 @@
 #define	BITWISE_H
 
 #include <climits>
+#include <cstddef>
+#include <iostream>
 
 namespace bitwise {
 
+/*
+ * The functions below use the bit-manipulation builtins of GCC and Clang, 
+ * which compile to single instructions where the target has them, and are
+ * also usable in constant expressions. Other compilers get portable 
+ * fallbacks with the same results. Types of up to 128 bits are supported.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define BITWISE_BUILTINS
+#endif
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_bitreverse64)
+#define BITWISE_BITREVERSE
+#endif
+#endif
+
+namespace detail {
+
+typedef unsigned long long word;
+
+/** The number of bits in @c word. */
+constexpr size_t word_bits = sizeof(word) * CHAR_BIT;
+
+/** The number of bits in @p B. */
+template<typename B>
+constexpr size_t bits(){
+    return sizeof(B) * CHAR_BIT;
+}
+
+/** The mask of the lowest @p n bits of a @p B, for @p n up to its width. */
+template<typename B>
+constexpr B low(size_t n){
+    return n ? (B) (((B) ~(B) 0) >> (bits<B>() - n)) : (B) 0;
+}
+
+/** The bits of @p b above the lowest @c word_bits, or @p b itself for types
+ *  no wider than @c word (where it is never used). */
+template<typename B>
+constexpr word high(B b){
+    return (word) (b >> (word_bits % bits<B>()));
+}
+
+/** Counts the 1-bits in @p x. */
+constexpr size_t popcount(word x){
+#ifdef BITWISE_BUILTINS
+    return __builtin_popcountll(x);
+#else
+    return x ? 1 + popcount(x & (x - 1)) : 0;
+#endif
+}
+
+/** Counts the 0-bits above the highest 1-bit in @p x, which must not be 0. */
+constexpr size_t clz(word x){
+#ifdef BITWISE_BUILTINS
+    return __builtin_clzll(x);
+#else
+    return (x >> (word_bits - 1)) ? 0 : 1 + clz(x << 1);
+#endif
+}
+
+/** Counts the 0-bits below the lowest 1-bit in @p x, which must not be 0. */
+constexpr size_t ctz(word x){
+#ifdef BITWISE_BUILTINS
+    return __builtin_ctzll(x);
+#else
+    return (x & 1) ? 0 : 1 + ctz(x >> 1);
+#endif
+}
+
+/** Swaps each group of @p s bits selected by @p m with the group above. */
+constexpr word swap_bits(word x, size_t s, word m){
+    return ((x >> s) & m) | ((x & m) << s);
+}
+
+/** Reverses the bits of @p x, with Ken Raeburn's algorithm in O(lg(n)) 
+ *  operations. */
+constexpr word reverse(word x){
+#ifdef BITWISE_BITREVERSE
+    return __builtin_bitreverse64(x);
+#else
+    return swap_bits(swap_bits(swap_bits(swap_bits(swap_bits(swap_bits(x,
+        1, 0x5555555555555555ull), 2, 0x3333333333333333ull), 
+        4, 0x0F0F0F0F0F0F0F0Full), 8, 0x00FF00FF00FF00FFull), 
+        16, 0x0000FFFF0000FFFFull), 32, 0x00000000FFFFFFFFull);
+#endif
+}
+
+}
+
 /**
  * @brief Undoes the shift operator <tt> 1 << s </tt> to retrieve @c s.
  * 
- * @tparam B    a binary integer type.
+ * @tparam B    an unsigned binary integer type.
  * @param shifted   the shifted quantity. All sub-leading bits are ignored.
- * @return  the number @c s.
+ * @return  the number @c s, i.e. the index of the highest 1-bit, or 0 if
+ *          there is none.
  */
 template<typename B>
-size_t unshift(B shifted){
-    size_t unshifted = 0;
-    for(B b = (shifted >> 1); b; b >>= 1, unshifted++);
-    return unshifted;
+constexpr size_t unshift(B shifted){
+    return (sizeof(B) > sizeof(detail::word) && detail::high(shifted))
+        ? detail::word_bits + detail::word_bits - 1 
+            - detail::clz(detail::high(shifted))
+        : (detail::word) shifted 
+        ? detail::word_bits - 1 - detail::clz((detail::word) shifted) 
+        : 0;
 }
 
 /**
  * @brief Counts the number of 1-bits in an integer.
  * 
- * This uses Brian Kernighan's trick, whose cost goes as the number of 1-bits,
- * not as the total number of bits.
- * 
- * @tparam  B   a binary integer type.
+ * @tparam  B   an unsigned binary integer type.
  * @param bits  the integer.
  * @return  the number of 1-bits.
  */
 template<typename B>
-size_t bitcount(B bits){
-    size_t count = 0;
-    for(; bits; count++)
-        bits &= (bits - 1);
-    return count;
+constexpr size_t bitcount(B bits){
+    return detail::popcount((detail::word) bits)
+        + (sizeof(B) > sizeof(detail::word) 
+            ? detail::popcount(detail::high(bits)) : 0);
 }
 
 /**
- * @brief Reverses the binary representation of an integer.
+ * @brief Counts the 0-bits below the lowest 1-bit of an integer.
  * 
- * The algorithm is due to Ken Raeburn and works in O(lg(n)) operations, where
- * n is the size of @p B in bits.
+ * @tparam  B   an unsigned binary integer type.
+ * @param bits  the integer.
+ * @return  the number of trailing 0-bits, which is the number of bits in 
+ *          @p B if @p bits is 0.
+ */
+template<typename B>
+constexpr size_t trailing_zeros(B bits){
+    return (detail::word) bits 
+        ? detail::ctz((detail::word) bits)
+        : (sizeof(B) > sizeof(detail::word) && detail::high(bits))
+        ? detail::word_bits + detail::ctz(detail::high(bits))
+        : detail::bits<B>();
+}
+
+/**
+ * @brief Counts the 0-bits above the highest 1-bit of an integer.
  * 
- * @tparam  B   a binary integer type.
+ * @tparam  B   an unsigned binary integer type.
+ * @param bits  the integer.
+ * @return  the number of leading 0-bits, which is the number of bits in 
+ *          @p B if @p bits is 0.
+ */
+template<typename B>
+constexpr size_t leading_zeros(B bits){
+    return bits ? detail::bits<B>() - 1 - unshift(bits) : detail::bits<B>();
+}
+
+/**
+ * @brief Reverses the binary representation of an integer.
+ * 
+ * @tparam  B   an unsigned binary integer type.
  * @param bits  the integer.
  * @return  the reversed integer.
  */
 template<typename B>
-B reverse(B bits){
-    size_t s = sizeof(B) * CHAR_BIT;
-    B mask = ~((B) 0);         
-    while((s >>= 1) > 0){
-        mask ^= (mask << s);
-        bits = ((bits >> s) & mask) | ((bits << s) & ~mask);
-    }
+constexpr B reverse(B bits){
+    return sizeof(B) > sizeof(detail::word)
+        ? (B) (((B) detail::reverse((detail::word) bits) 
+                    << (detail::word_bits % detail::bits<B>()))
+               | (B) detail::reverse(detail::high(bits)))
+        : (B) (detail::reverse((detail::word) bits) 
+               >> ((detail::word_bits - detail::bits<B>()) 
+                    % detail::word_bits));
+}
+
+/**
+ * @brief Rotates a block of bits in an integer, leaving the other bits as 
+ * they are.
+ * 
+ * @tparam  B   an unsigned binary integer type.
+ * @param bits  the integer.
+ * @param offs  the index of the lowest bit in the block.
+ * @param len   the number of bits in the block, at least 1.
+ * @param steps the number of steps by which the block is rotated towards 
+ *              higher indices, less than @p len . The bits rotated past the
+ *              top of the block reappear at its bottom.
+ * @return  the rotated integer.
+ */
+template<typename B>
+constexpr B rotate(B bits, size_t offs, size_t len, size_t steps){
+    return steps == 0 ? bits
+        : (B) ((bits & ~(detail::low<B>(len) << offs))
+               | ((((bits >> offs) << steps) & detail::low<B>(len)) << offs)
+               | (((bits >> offs) & detail::low<B>(len)) >> (len - steps)
+                  << offs));
 }
 
 /**
@@ -100,9 +240,9 @@ void print_bits(B bits, size_t size = CHAR_BIT * sizeof(B),
     else
         mask = one << bitwise::unshift(bits);
     
-    for(; (reverse && mask) 
-            || (size && mask < (one << size)) 
-            || (((mask-1) & bits) != bits);)
+    for(size_t i = 0; (reverse && mask) 
+            || (size && !reverse && i < size) 
+            || (((mask-1) & bits) != bits); i++)
     {
         if(bits & mask)
             out << high;
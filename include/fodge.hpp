@@ -13,6 +13,7 @@
 
 #include <cstdlib>
 #include <cstdint>
+#include <climits>
 #include <cassert>
 #include <cstring>
 #include <cmath>
@@ -38,20 +39,106 @@
 
 #define PI 3.14159265358979
 
+/** The number of bits in a momentum mask, which is the largest number of 
+ *  external legs a diagram can have. Chosen at compile time; the build 
+ *  makes one executable for each supported width. */
+#ifndef FODGE_MMASK_BITS
+#define FODGE_MMASK_BITS 32
+#endif
+
 /** Bitmask specifying a sum of some momenta 
  *  (those whose indices correspond to 1-bits) */
+#if FODGE_MMASK_BITS == 16
+typedef uint16_t mmask;
+#elif FODGE_MMASK_BITS == 32
 typedef uint32_t mmask;
+#elif FODGE_MMASK_BITS == 64
+typedef uint64_t mmask;
+#elif FODGE_MMASK_BITS == 128 && defined(__SIZEOF_INT128__)
+typedef unsigned __int128 mmask;
+#else
+#error "FODGE_MMASK_BITS must be 16, 32, 64 or 128 (if supported)"
+#endif
+static_assert(PERMUTE_CAPACITY >= FODGE_MMASK_BITS,
+    "PERMUTE_CAPACITY must allow permutations of all momenta");
 /** An order-flavour split pair specifying a vertex. */
 typedef std::pair<int, std::vector<int>> vertex;
+/** A leg to which vertices can be attached, given as a traversal of 
+ *  (trace-idx, leg-idx) pairs from the root (see @link Diagram::attach 
+ *  @endlink), and whether singlet propagators may be used there. */
+typedef std::pair<std::vector<std::pair<int, int>>, bool> site;
 
 /** Returns true if the 1-bits of a is a subset of the 1-bits of b. */
 #define SUBSET(a,b) (((a) & (b)) == (a))
 
+/** Mixes the hash value @p h into the running hash @p seed . */
+inline void hash_combine(size_t& seed, size_t h){
+    seed ^= h + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+/** Scrambles the hash value @p h so that every bit of the result depends on
+ *  every bit of @p h . Sums of scrambled hashes can then be used as hashes 
+ *  of sets, which do not depend on the order of the elements. */
+inline size_t mix_hash(size_t h){
+    uint64_t x = h;
+    x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return (size_t) (x ^ (x >> 31));
+}
+
+/** Returns the mask of the momenta with indices below @p n , for @p n up to
+ *  @c FODGE_MMASK_BITS. Unlike <tt> (1 << n) - 1 </tt>, this is also 
+ *  defined for the full width. */
+inline mmask low_momenta(int n){
+    return n > 0 ? (mmask) (((mmask) ~((mmask) 0)) >> (FODGE_MMASK_BITS - n))
+                 : (mmask) 0;
+}
+
+/** Hashes a momentum mask. This is the same as @c std::hash, but also works 
+ *  for masks wider than @c size_t. */
+inline size_t hash_mmask(mmask m){
+    const int w = CHAR_BIT * sizeof(size_t);
+    size_t h = (size_t) m;
+    for(int i = w; i < FODGE_MMASK_BITS; i += w)
+        hash_combine(h, (size_t) (m >> i));
+    return h;
+}
+
+/** Hashes momentum masks in unordered containers. */
+struct mmask_hash {
+    size_t operator()(mmask m) const    {   return hash_mmask(m);   }
+};
+
+/** Wraps a momentum mask to print it in hexadecimal, which the streams do 
+ *  not support for masks wider than 64 bits. */
+struct mmask_hex {
+    explicit mmask_hex(mmask m) : m(m) {}
+    mmask m;
+};
+
+/** Prints a momentum mask in hexadecimal, honouring @c std::uppercase. */
+inline std::ostream& operator<<(std::ostream& out, mmask_hex h){
+    const char* digits = (out.flags() & std::ios::uppercase) 
+        ? "0123456789ABCDEF" : "0123456789abcdef";
+    char buf[FODGE_MMASK_BITS / 4 + 1];
+    char* p = buf + sizeof(buf);
+    *--p = '\0';
+    do{
+        *--p = digits[(int) (h.m & 15)];
+        h.m >>= 4;
+    } while(h.m);
+    
+    return out << p;
+}
+
 class Diagram;
 class DiagramNode;
 class Labelling;
 class Propagator;
 
+template<typename T1, typename T2>
+std::ostream& operator<<(std::ostream& out, const std::pair<T1, T2> pair);
+
 /**
  * @brief Prints a vector as a space-separated sequence of elements,
  * surrounded by curly braces.
@@ -18,6 +18,7 @@
 #include <algorithm>
 
 #include "Permutation.hpp"
+#include "BitPermutation.hpp"
 #include "Generator.hpp"
 
 #endif	/* PERMUTE_H */
@@ -0,0 +1,225 @@
+/*
+ * File:   Binary.cpp
+ *
+ * Implements the compact binary input and output of diagrams, declared in
+ * Diagram.hpp, DiagramNode.hpp, Labelling.hpp and Propagator.hpp.
+ */
+
+#include "Diagram.hpp"
+#include "DiagramNode.hpp"
+#include "Labelling.hpp"
+#include "Propagator.hpp"
+#include "binary.hpp"
+
+/** Sanity limit on the depth of a stored diagram tree. */
+#define MAX_TREE_DEPTH 64
+
+/**
+ * @brief Writes a complete diagram, including all its labellings, in a
+ * compact binary form.
+ *
+ * @param out the stream to write to.
+ *
+ * The diagram can be restored with @link Diagram::read @endlink, without
+ * having to be indexed or labelled again.
+ */
+void Diagram::write(std::ostream& out) const {
+    binary::write(out, (int32_t) order);
+    binary::write(out, (int32_t) n_legs);
+    binary::write(out, (uint8_t) singlet_diagram);
+
+    binary::write_size(out, flav_split.size());
+    for(int r : flav_split)
+        binary::write(out, (int32_t) r);
+
+    root.write(out);
+
+    binary::write_size(out, labellings.size());
+    for(const Labelling& lbl : labellings)
+        lbl.write(out);
+}
+
+/**
+ * @brief Restores a diagram written by @link Diagram::write @endlink.
+ *
+ * @param in the stream to read from.
+ * @return @c true if the diagram was read successfully, @c false if the input
+ *      was truncated or malformed, in which case the diagram is left in an
+ *      unspecified state.
+ */
+bool Diagram::read(std::istream& in){
+    order = binary::read<int32_t>(in);
+    n_legs = binary::read<int32_t>(in);
+    singlet_diagram = binary::read<uint8_t>(in);
+
+    flav_split.clear();
+    size_t n_splits = binary::read_size(in, n_legs);
+    for(size_t i = 0; i < n_splits && in; i++)
+        flav_split.push_back(binary::read<int32_t>(in));
+
+    if(!in || flav_split.empty() || !root.read(in))
+        return false;
+
+    labellings.clear();
+    size_t n_lbls = binary::read_size(in, binary::MAX_SIZE);
+    for(size_t i = 0; i < n_lbls && in; i++){
+        labellings.push_back(Labelling());
+        if(!labellings.back().read(in))
+            return false;
+    }
+
+    return in && !labellings.empty();
+}
+
+/**
+ * @brief Recursively writes a node and its descendants in a compact binary
+ * form.
+ *
+ * @param out the stream to write to.
+ */
+void DiagramNode::write(std::ostream& out) const {
+    binary::write(out, (uint8_t) (is_leaf | (is_root << 1) | (is_singlet << 2)));
+    binary::write(out, momenta);
+    if(is_leaf)
+        return;
+
+    binary::write(out, (int32_t) order);
+    binary::write(out, (int32_t) n_legs);
+    binary::write(out, (int32_t) connect_idx);
+
+    binary::write_size(out, traces.size());
+    for(const FlavourTrace& tr : traces){
+        binary::write(out, (int32_t) tr.n_idcs);
+        binary::write(out, (uint8_t) tr.connected);
+        binary::write(out, tr.momenta);
+
+        binary::write_size(out, tr.legs.size());
+        for(const DiagramNode& leg : tr.legs)
+            leg.write(out);
+    }
+}
+
+/**
+ * @brief Restores a node written by @link DiagramNode::write @endlink.
+ *
+ * @param in    the stream to read from.
+ * @param depth the depth in the tree, used to reject malformed input.
+ * @return @c true if the node was read successfully, @c false otherwise.
+ */
+bool DiagramNode::read(std::istream& in, int depth){
+    uint8_t flags = binary::read<uint8_t>(in);
+    is_leaf = flags & 1;
+    is_root = flags & 2;
+    is_singlet = flags & 4;
+    momenta = binary::read<mmask>(in);
+
+    traces.clear();
+    if(is_leaf){
+        order = 0;
+        n_legs = 0;
+        connect_idx = -1;
+        return (bool) in;
+    }
+    if(depth > MAX_TREE_DEPTH)
+        return false;
+
+    order = binary::read<int32_t>(in);
+    n_legs = binary::read<int32_t>(in);
+    connect_idx = binary::read<int32_t>(in);
+
+    size_t n_traces = binary::read_size(in, n_legs + 1);
+    for(size_t i = 0; i < n_traces && in; i++){
+        traces.push_back(FlavourTrace());
+        FlavourTrace& tr = traces.back();
+
+        tr.n_idcs = binary::read<int32_t>(in);
+        tr.connected = binary::read<uint8_t>(in);
+        tr.momenta = binary::read<mmask>(in);
+
+        size_t n_tr_legs = binary::read_size(in, n_legs + 1);
+        for(size_t j = 0; j < n_tr_legs && in; j++){
+            tr.legs.push_back(DiagramNode());
+            if(!tr.legs.back().read(in, depth + 1))
+                return false;
+        }
+    }
+
+    return (bool) in;
+}
+
+/**
+ * @brief Writes a labelling in a compact binary form.
+ *
+ * @param out the stream to write to.
+ */
+void Labelling::write(std::ostream& out) const {
+    binary::write_size(out, perm.size());
+    for(size_t i : perm)
+        binary::write(out, (uint8_t) i);
+
+    binary::write_size(out, props.size());
+    for(const Propagator& p : props)
+        p.write(out);
+}
+
+/**
+ * @brief Restores a labelling written by @link Labelling::write @endlink.
+ *
+ * @param in the stream to read from.
+ * @return @c true if the labelling was read successfully, @c false otherwise.
+ */
+bool Labelling::read(std::istream& in){
+    auto map = std::vector<uint8_t>();
+    map.resize(binary::read_size(in, CHAR_BIT * sizeof(mmask)));
+    for(uint8_t& i : map)
+        i = binary::read<uint8_t>(in);
+
+    if(!in || map.empty()
+            || !permute::Permutation::is_permutation(map.begin(), map.end()))
+        return false;
+    perm = permute::Permutation(map.begin(), map.end());
+
+    props.clear();
+    size_t n_props = binary::read_size(in, map.size());
+    for(size_t i = 0; i < n_props && in; i++){
+        props.push_back(Propagator());
+        if(!props.back().read(in))
+            return false;
+    }
+
+    return (bool) in;
+}
+
+/**
+ * @brief Writes a propagator in a compact binary form.
+ *
+ * @param out the stream to write to.
+ */
+void Propagator::write(std::ostream& out) const {
+    binary::write(out, momenta());
+    binary::write(out, n_mom);
+    binary::write(out, (uint8_t) src_order());
+    binary::write(out, src_prev());
+    binary::write(out, (uint8_t) dst_order());
+    binary::write(out, dst_prev());
+}
+
+/**
+ * @brief Restores a propagator written by @link Propagator::write @endlink.
+ *
+ * @param in the stream to read from.
+ * @return @c true if the propagator was read successfully, @c false otherwise.
+ *
+ * The stored propagator is already normalised, so no normalisation is done.
+ */
+bool Propagator::read(std::istream& in){
+    mmask momenta = binary::read<mmask>(in);
+    n_mom = binary::read<uint8_t>(in);
+    int src_order = binary::read<uint8_t>(in);
+    mmask src_prev = binary::read<mmask>(in);
+    int dst_order = binary::read<uint8_t>(in);
+    mmask dst_prev = binary::read<mmask>(in);
+    pack(momenta, src_order, src_prev, dst_order, dst_prev);
+
+    return (bool) in;
+}
@@ -8,8 +8,54 @@
  */
 
 #include "Diagram.hpp"
+#include "DiagramCache.hpp"
+#include "DiagramSet.hpp"
+#include "ZRGroup.hpp"
 
+#include <atomic>
 #include <sstream>
+#include <set>
+#include "TaskPool.hpp"
+
+/** The number of elements of Z_R in a chunk, when a diagram is labelled in
+ *  chunks by Diagram::label_all. */
+#define LABEL_CHUNK ((size_t) 1 << 12)
+
+int Diagram::n_threads = 1;
+bool Diagram::orderly = false;
+
+/**
+ * @brief Sets the number of threads used to extend diagrams during 
+ * generation.
+ * 
+ * The threads share the work through a @link TaskPool @endlink.
+ * 
+ * @param n the number of threads. Values below 2 give a serial generation.
+ */
+void Diagram::set_threads(int n){
+    n_threads = n;
+}
+
+/**
+ * @brief Enables or disables orderly generation.
+ * 
+ * In orderly generation (canonical augmentation), diagrams are only extended
+ * at one leg from each class of legs that are equivalent under the symmetries
+ * of the diagram, and an extension is only kept if the attached vertex is, up 
+ * to symmetry, the canonical last vertex of the new diagram (see 
+ * @link Diagram::canonical_extension @endlink). Most distinct diagrams are
+ * then built once, instead of once for every way of building them. The rest
+ * are still deduplicated as they are attached.
+ * 
+ * The generated sets are the same as without orderly generation, but the 
+ * representative of each diagram, and thus the printed permutations, may 
+ * differ.
+ * 
+ * @param enable @c true to enable orderly generation.
+ */
+void Diagram::set_orderly(bool enable){
+    orderly = enable;
+}
 
 /** 
  * @brief Default constructor.
@@ -38,6 +84,31 @@ Diagram::Diagram(int order, const std::vector<int>& fsplit)
     labellings.push_back(Labelling(root, n_legs));
 }
 
+/**
+ * @brief Extension constructor.
+ * 
+ * @param seed      the diagram to extend.
+ * @param new_vert  the vertex to attach.
+ * @param split_idx which flavour-split part of the vertex to attach by.
+ * @param where     the location in @p seed of the leg to attach to, see 
+ *                  @link Diagram::attach @endlink.
+ * @param singlet   if @c true, the vertex is attached by a singlet propagator.
+ * 
+ * Creates the diagram made by attaching a vertex to @p seed, and finds its
+ * flavour split. Only the tree of @p seed is copied. Its labellings, which
+ * are by far the largest part of a finished diagram, are not, since the new 
+ * diagram must be labelled anew anyway.
+ */
+Diagram::Diagram(const Diagram& seed, const vertex& new_vert, int split_idx,
+                 const std::vector<std::pair<int,int> >& where, bool singlet)
+: order(seed.order + new_vert.first - 2), n_legs(seed.n_legs), flav_split(), 
+        singlet_diagram(seed.singlet_diagram || singlet), root(seed.root), 
+        labellings()
+{
+    root.attach(new_vert, split_idx, where, 0, singlet, false);
+    find_flav_split();
+}
+
 /**
  * @brief Checks if a diagram vanishes identically. 
  * 
@@ -46,7 +117,7 @@ Diagram::Diagram(int order, const std::vector<int>& fsplit)
  * 
  * @return @c true if the diagram vanishes.
  */
-bool Diagram::is_zero(){
+bool Diagram::is_zero() const {
     if(flav_split[0] == 1)
         return true;
     if(order < 6)
@@ -55,6 +126,17 @@ bool Diagram::is_zero(){
     return root.is_zero();
 }
 
+/**
+ * @brief Checks if a diagram vanishes identically, and so does every diagram
+ * made from it by @link Diagram::extend @endlink.
+ * 
+ * @return @c true only if the diagram is zero and cannot be made nonzero by 
+ *      attaching more vertices (see @link DiagramNode::stays_zero @endlink).
+ */
+bool Diagram::stays_zero() const {
+    return order >= 6 && root.stays_zero();
+}
+
 /**
  * @brief Generates all distinct flavour-ordered diagrams with the given
  * properties.
@@ -68,6 +150,7 @@ bool Diagram::is_zero(){
  *                      should normally only be @c false when the method calls
  *                      itself.
  * @param debug         enables debug printouts.
+ * @param filter        if given, only diagrams admitted by it are generated.
  * @return  a sorted vector containing the diagrams.
  * 
  * This is the main method for creating diagrams. It works by generating all
@@ -75,63 +158,483 @@ bool Diagram::is_zero(){
  * generating smaller and lower-order diagrams and extending them to the target
  * size and order. Finally, redundant diagrams are trimmed and the list of
  * diagrams is sorted.
+ * 
+ * Every generated set, including those of the recursive steps, is kept in the
+ * @link DiagramCache @endlink, so repeated calls within the same process
+ * only generate each set once. A filtered set is not kept, see 
+ * @link Diagram::generate_filtered @endlink.
  */
 std::vector< Diagram > Diagram::generate ( int order, int n_legs, 
-                        bool singlets, bool traceless_generators, bool debug )
+                        bool singlets, bool traceless_generators, bool debug,
+                        const FlavSplitFilter* filter )
 {
+    auto filtered = std::vector<Diagram>();
+    if(filter)
+        filtered = generate_filtered(order, n_legs, singlets, filter, 
+                                     debug, false);
     
-    auto diagrs = std::vector<Diagram>();
-    //Generates single-vertex diagrams to seed the recursion.
-    for(auto& flav_split : valid_flav_splits(order, n_legs)){
+    const std::vector<Diagram>& diagrs = filter ? filtered
+        : generate_cached(order, n_legs, singlets, debug);
+    
+    //Removes identically zero diagrams
+    if( traceless_generators ){
+        auto nonzero = std::vector<Diagram>();
+        for(const Diagram& d : diagrs){
+            if(!d.is_zero())
+                nonzero.push_back(d);
+        }
+        return nonzero;
+    }
+    
+    return diagrs;
+}
+
+/**
+ * @brief Generates all distinct flavour-ordered diagrams with the given
+ * properties, building all intermediate sets bottom-up.
+ * 
+ * @param order         the order of the diagrams.
+ * @param n_legs        the number of legs on the diagrams.
+ * @param singlets      whether to include singlet diagrams.
+ * @param traceless_generators 
+ *                      whether to remove diagrams that are identically zero 
+ *                      due to traceless generators.
+ * @param debug         enables debug printouts.
+ * @param filter        if given, only diagrams admitted by it are generated.
+ * @return  a sorted vector containing the diagrams, identical to the output of
+ *          @link Diagram::generate @endlink.
+ * 
+ * Rather than recursing from the target, this first collects every 
+ * (order, legs) set that the target depends on, and then generates them in
+ * order of increasing size, so that each set is built exactly once and only
+ * after all sets it depends on. Each set is freed as soon as the last set 
+ * depending on it has been generated, which keeps the peak memory usage down.
+ * The in-memory @link DiagramCache @endlink is neither consulted nor filled,
+ * but sets found in its cache directory are loaded rather than generated
+ * (and their own dependencies skipped), and generated sets are saved there,
+ * except for a filtered target.
+ */
+std::vector<Diagram> Diagram::generate_bottom_up(int order, int n_legs, 
+                        bool singlets, bool traceless_generators, bool debug,
+                        const FlavSplitFilter* filter)
+{
+    //Finds all sets that the target depends on, and counts how many
+    //sets depend on each of them. The target itself is held by the caller.
+    auto target = std::make_pair(order, n_legs);
+    auto n_users = std::map<std::pair<int, int>, int>();
+    n_users[target] = 1;
+    
+    auto cached = std::set<std::pair<int, int>>();
+    auto pending = std::vector<std::pair<int, int>>(1, target);
+    while(!pending.empty()){
+        auto cell = pending.back();
+        pending.pop_back();
         
-        if(debug){
-            std::cout << "Generating diagram with flavour split " 
-                    << flav_split << std::endl;
+        if(DiagramCache::on_disk(cell.first, cell.second, singlets)){
+            cached.insert(cell);
+            continue;
         }
         
-        diagrs.push_back(Diagram(order, flav_split));
+        for(auto& sub : subproblems(cell.first, cell.second)){
+            if(n_users[sub]++ == 0)
+                pending.push_back(sub);
+        }
     }
     
-    //Recurses over all necessary smaller (size n) and lower-order (order o) 
-    //diagrams and extends them.  
-    //The extension is never by more orders than the order of the extended 
-    //diagram. This cuts the number of o's in half.
-    //The same can applied to n only when extension and extended diagram
-    //are of the same order. Otherwise, all n must be covered.
-    //Identically zero diagrams are not removed when recursing, since they may
-    //be rendered nonzero by the extensions.
-    for(int o = order; o > order/2; o -= 2){
-        int n_min = (n_legs <= 8 || 2*o != 2+order) ? 4 : n_legs/2;
-        for(int n = n_legs - 2; n >= n_min; n -= 2){
-            for(Diagram& d : generate(o, n, singlets, false, debug)){
-                if(debug)
-                    std::cout << "Extending " << d;
-                
-                auto d_ext 
-                    = d.extend(valid_vertices(2 + order - o, 2 + n_legs - n), 
-                        singlets && (o > 2) && (order > 4), debug);
-                diagrs.insert(diagrs.end(), d_ext.begin(), d_ext.end());
+    //Every set depends only on strictly smaller sets, so generating in order
+    //of increasing size respects all dependencies.
+    auto schedule = std::vector<std::pair<int, int>>();
+    for(auto& cell_users : n_users)
+        schedule.push_back(cell_users.first);
+    std::sort(schedule.begin(), schedule.end(), 
+        [](const std::pair<int, int>& a, const std::pair<int, int>& b){
+            return a.second != b.second ? a.second < b.second 
+                                        : a.first < b.first;
+        });
+    
+    auto done = std::map<std::pair<int, int>, std::vector<Diagram>>();
+    for(auto& cell : schedule){
+        if(cached.count(cell)
+                && DiagramCache::load(cell.first, cell.second, singlets, 
+                                      done[cell]))
+        {
+            if(debug){
+                std::cout << "Loaded O(p^" << cell.first << ") " 
+                          << cell.second << "-point diagrams from cache" 
+                          << std::endl;
+            }
+            continue;
+        }
+        
+        //A set whose cache file turns out to be unreadable was scheduled 
+        //without its dependencies, so it is generated recursively instead
+        //(which also replaces the bad file).
+        if(cached.count(cell)){
+            done[cell] = generate_cached(cell.first, cell.second, singlets, 
+                                         debug);
+            continue;
+        }
+        
+        auto cell_subs = subproblems(cell.first, cell.second);
+        
+        auto subs = subproblem_table();
+        for(auto& sub : cell_subs)
+            subs[sub] = &done.at(sub);
+        
+        if(debug){
+            std::cout << "Scheduling O(p^" << cell.first << ") " 
+                      << cell.second << "-point diagrams" << std::endl;
+        }
+        if(filter && cell == target){
+            done[cell] = generate_uncached(cell.first, cell.second, singlets, 
+                                           subs, debug, false, filter);
+        }
+        else{
+            done[cell] = generate_uncached(cell.first, cell.second, singlets, 
+                                           subs, debug);
+            DiagramCache::save(cell.first, cell.second, singlets, done[cell]);
+        }
+        
+        //Frees all sets that are no longer needed.
+        for(auto& sub : cell_subs){
+            if(--n_users[sub] == 0){
+                if(debug){
+                    std::cout << "Releasing O(p^" << sub.first << ") " 
+                              << sub.second << "-point diagrams" << std::endl;
+                }
+                done.erase(sub);
             }
         }
     }
     
-    //Sorts and removes redundant diagrams.
-    std::sort(diagrs.begin(), diagrs.end());
-    std::vector<Diagram>::iterator last 
-            = std::unique(diagrs.begin(), diagrs.end());
-    diagrs.resize(std::distance(diagrs.begin(), last));
+    std::vector<Diagram>& diagrs = done.at(target);
+    
+    //A target loaded from the cache directory is not yet filtered
+    if(filter)
+        filter_flav_split(diagrs, *filter);
     
     //Removes identically zero diagrams
     if( traceless_generators ){
         auto nonzero = std::vector<Diagram>();
-        for(Diagram& d : diagrs){
+        for(const Diagram& d : diagrs){
             if(!d.is_zero())
                 nonzero.push_back(d);
         }
         return nonzero;
     }
     
-    return diagrs;
+    return std::move(diagrs);
+}
+
+/**
+ * @brief Generates all distinct flavour-ordered diagrams with the given 
+ * properties, but only keeps what is needed to count them.
+ * 
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @param singlets  whether to include singlet diagrams.
+ * @param debug     enables debug printouts.
+ * @param filter    if given, only diagrams admitted by it are counted.
+ * @return  a sorted vector containing the diagrams that are not identically
+ *          zero, stripped by @link Diagram::strip @endlink. These can be 
+ *          counted, summarised and filtered, but not printed or drawn.
+ * 
+ * This is not a combinatorial count: every diagram is still generated and 
+ * labelled as by @link Diagram::generate @endlink, and the smaller sets are 
+ * kept in full, since they are needed to be extended. Each diagram of the 
+ * requested set is stripped as soon as it has been generated, which removes
+ * the largest set from the memory use, but not from the running time. The
+ * stripped set is not stored in the @link DiagramCache @endlink, but is 
+ * taken from it if already there.
+ */
+std::vector<Diagram> Diagram::generate_stripped(
+    int order, int n_legs, bool singlets, bool debug, 
+    const FlavSplitFilter* filter)
+{
+    return generate_filtered(order, n_legs, singlets, filter, debug, true);
+}
+
+/**
+ * @brief Generates a set of diagrams that is not to be stored in the 
+ * @link DiagramCache @endlink, since it is filtered or stripped.
+ * 
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @param singlets  whether to include singlet diagrams.
+ * @param filter    if not @c nullptr, only diagrams admitted by it are 
+ *                  generated.
+ * @param debug     enables debug printouts.
+ * @param counting  if @c true, the diagrams are stripped and identically 
+ *                  zero ones removed, as for 
+ *                  @link Diagram::generate_stripped @endlink.
+ * @return  a sorted vector containing the diagrams.
+ * 
+ * The smaller sets are taken from the cache, or generated in full and 
+ * stored there. If the requested set is already in the cache, it is 
+ * filtered and stripped instead of being generated.
+ */
+std::vector<Diagram> Diagram::generate_filtered(
+    int order, int n_legs, bool singlets, const FlavSplitFilter* filter, 
+    bool debug, bool counting)
+{
+    const std::vector<Diagram>* cached 
+        = DiagramCache::lookup(order, n_legs, singlets);
+    if(cached){
+        auto diagrs = std::vector<Diagram>();
+        for(const Diagram& d : *cached){
+            if((filter && !filter->admits(d.flav_split)) 
+                    || (counting && d.is_zero()))
+                continue;
+            
+            diagrs.push_back(d);
+            if(counting)
+                diagrs.back().strip();
+        }
+        return diagrs;
+    }
+    
+    auto subs = subproblem_table();
+    for(auto& sub : subproblems(order, n_legs))
+        subs[sub] = &generate_cached(sub.first, sub.second, singlets, debug);
+    
+    return generate_uncached(order, n_legs, singlets, subs, debug, 
+                             counting, filter);
+}
+
+/**
+ * @brief Lists the smaller and lower-order sets of diagrams that are 
+ * extended when generating diagrams of a given order and size.
+ * 
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @return  a vector of (order, n_legs) pairs.
+ * 
+ * The extension is never by more orders than the order of the extended 
+ * diagram. This cuts the number of orders in half.
+ * The same can applied to the number of legs only when extension and extended
+ * diagram are of the same order. Otherwise, all sizes must be covered.
+ */
+std::vector<std::pair<int, int>> Diagram::subproblems(int order, int n_legs){
+    auto subs = std::vector<std::pair<int, int>>();
+    
+    for(int o = order; o > order/2; o -= 2){
+        int n_min = (n_legs <= 8 || 2*o != 2+order) ? 4 : n_legs/2;
+        for(int n = n_legs - 2; n >= n_min; n -= 2)
+            subs.push_back(std::make_pair(o, n));
+    }
+    
+    return subs;
+}
+
+/**
+ * @brief Retrieves a set of diagrams from the @link DiagramCache @endlink,
+ * generating and storing it first if needed.
+ * 
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @param singlets  whether to include singlet diagrams.
+ * @param debug     enables debug printouts.
+ * @return  a reference to the cached set, which includes identically zero
+ *          diagrams, except those that stay zero (see 
+ *          @link Diagram::stays_zero @endlink).
+ */
+const std::vector<Diagram>& Diagram::generate_cached(
+    int order, int n_legs, bool singlets, bool debug)
+{
+    const std::vector<Diagram>* cached 
+        = DiagramCache::lookup(order, n_legs, singlets);
+    if(cached){
+        if(debug){
+            std::cout << "Reusing O(p^" << order << ") " << n_legs 
+                      << "-point diagrams from cache" << std::endl;
+        }
+        return *cached;
+    }
+    
+    auto subs = subproblem_table();
+    for(auto& sub : subproblems(order, n_legs))
+        subs[sub] = &generate_cached(sub.first, sub.second, singlets, debug);
+    
+    return DiagramCache::store(order, n_legs, singlets, 
+                generate_uncached(order, n_legs, singlets, subs, debug));
+}
+
+/**
+ * @brief Implements @link Diagram::generate @endlink for a single set of 
+ * diagrams, without zero removal.
+ * 
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @param singlets  whether to include singlet diagrams.
+ * @param subs      the diagrams of every set listed by 
+ *                  @link Diagram::subproblems @endlink.
+ * @param debug     enables debug printouts.
+ * @param counting  if @c true, the diagrams are stripped and identically 
+ *                  zero diagrams removed, as needed by 
+ *                  @link Diagram::generate_stripped @endlink.
+ * @param filter    if not @c nullptr, only diagrams admitted by it are 
+ *                  generated. Extensions that cannot give such a diagram
+ *                  are skipped (see @link Diagram::can_reach @endlink), 
+ *                  and the rest are checked before they are labelled.
+ * @return  a sorted vector containing the diagrams.
+ */
+std::vector<Diagram> Diagram::generate_uncached(
+    int order, int n_legs, bool singlets, const subproblem_table& subs, 
+    bool debug, bool counting, const FlavSplitFilter* filter)
+{
+    //Duplicates are removed as soon as they are generated, so that memory
+    //use is proportional to the number of distinct diagrams. Each diagram is
+    //ranked by (seed, site, vertex, attachment) so that the set keeps the 
+    //same representatives as a serial run, regardless of threading.
+    //Seed 0 is reserved for the single-vertex diagrams.
+    DiagramSet diagrs(counting);
+    auto rank = [](size_t seed, size_t site, size_t vert, size_t att){
+        assert(site < (1 << 12) && vert < (1 << 12) && att < (1 << 8));
+        return ((DiagramSet::rank) seed << 32) | (site << 20) 
+                | (vert << 8) | att;
+    };
+    
+    //Generates single-vertex diagrams to seed the recursion.
+    size_t n_single = 0;
+    for(auto& flav_split : valid_flav_splits(order, n_legs)){
+        Diagram d(order, flav_split);
+        if(filter && !filter->admits(d.flav_split))
+            continue;
+        
+        if(debug){
+            std::cout << "Generating diagram with flavour split " 
+                    << flav_split << std::endl;
+        }
+        
+        diagrs.insert(std::move(d), rank(0, 0, 0, n_single++));
+    }
+    
+    //Extends all smaller and lower-order diagrams.
+    //Identically zero diagrams are not removed when recursing, since they may
+    //be rendered nonzero by the extensions. Those that stay zero are dropped
+    //by Diagram::attach.
+    auto seeds = std::vector<const Diagram*>();
+    auto seed_verts = std::vector<std::vector<vertex>>();
+    auto seed_singlets = std::vector<bool>();
+    auto seed_vert_idcs = std::vector<size_t>();
+    for(auto& sub : subproblems(order, n_legs)){
+        int o = sub.first, n = sub.second;
+        seed_verts.push_back(valid_vertices(2 + order - o, 2 + n_legs - n));
+        seed_singlets.push_back(singlets && (o > 2) && (order > 4));
+        
+        for(const Diagram& d : *subs.at(sub)){
+            seeds.push_back(&d);
+            seed_vert_idcs.push_back(seed_verts.size() - 1);
+        }
+    }
+    
+    //Finds the vertices that can be attached to seed i without ruling out
+    //every diagram admitted by the filter.
+    auto useful_verts = [&](size_t i){
+        const std::vector<vertex>& verts = seed_verts[seed_vert_idcs[i]];
+        auto useful = std::vector<size_t>();
+        for(size_t k = 0; k < verts.size(); k++){
+            if(!filter || can_reach(seeds[i]->flav_split, verts[k], 
+                    seed_singlets[seed_vert_idcs[i]] && (verts[k].first > 2), 
+                    *filter))
+                useful.push_back(k);
+        }
+        return useful;
+    };
+    
+    //Finds the sites of seed i, each with a flag telling whether ordinary 
+    //propagators are attached there. In orderly generation, singlet 
+    //propagators are still attached at the same sites as otherwise (see 
+    //Diagram::attach), and ordinary ones at one site per class of 
+    //equivalent legs.
+    auto seed_sites = [&](size_t i){
+        bool seed_singlet = seed_singlets[seed_vert_idcs[i]];
+        auto sites = std::vector<std::pair<site, bool>>();
+        if(!orderly || seeds[i]->singlet_diagram){
+            for(site& s : seeds[i]->extension_sites(seed_singlet, debug))
+                sites.push_back(std::make_pair(s, true));
+            return sites;
+        }
+        
+        if(seed_singlet){
+            for(site& s : seeds[i]->extension_sites(true, debug)){
+                if(s.second)
+                    sites.push_back(std::make_pair(s, false));
+            }
+        }
+        for(site& s : seeds[i]->extension_sites(false, debug, true))
+            sites.push_back(std::make_pair(s, true));
+        return sites;
+    };
+    
+    //Attaches vertex k at site j of seed i, and adds the results to the set.
+    auto attach_at = [&](size_t i, size_t j, size_t k, 
+                         const std::pair<site, bool>& s)
+    {
+        const vertex& v = seed_verts[seed_vert_idcs[i]][k];
+        auto d_ext = std::vector<Diagram>();
+        seeds[i]->attach(v, s.first.first, d_ext, 
+                         s.first.second && (v.first > 2), debug, filter, 
+                         s.second);
+        
+        for(size_t l = 0; l < d_ext.size(); l++)
+            diagrs.insert(std::move(d_ext[l]), rank(i + 1, j, k, l));
+    };
+    
+    if(n_threads > 1){
+        //The work per seed is very uneven, so each seed only finds its 
+        //extension sites and spawns a task per site and vertex, which idle
+        //threads can steal.
+        TaskPool pool(n_threads);
+        for(size_t i = 0; i < seeds.size(); i++){
+            pool.spawn([&, i](){
+                auto verts = useful_verts(i);
+                if(verts.empty())
+                    return;
+                if(debug)
+                    std::cout << "Extending " << *seeds[i];
+                
+                auto sites = seed_sites(i);
+                
+                for(size_t j = 0; j < sites.size(); j++){
+                    for(size_t k : verts){
+                        const std::pair<site, bool> s = sites[j];
+                        pool.spawn([&, i, j, k, s](){
+                            attach_at(i, j, k, s);
+                        });
+                    }
+                }
+            });
+        }
+        pool.run();
+    }
+    else{
+        for(size_t i = 0; i < seeds.size(); i++){
+            auto verts = useful_verts(i);
+            if(verts.empty())
+                continue;
+            if(debug)
+                std::cout << "Extending " << *seeds[i];
+            
+            auto sites = seed_sites(i);
+            
+            for(size_t j = 0; j < sites.size(); j++){
+                for(size_t k : verts)
+                    attach_at(i, j, k, sites[j]);
+            }
+        }
+    }
+    
+    if(debug){
+        std::cout << "Removed " << diagrs.duplicates() 
+                  << " duplicate diagrams" << std::endl;
+    }
+    
+    //Only the diagrams that were kept need all their labellings
+    auto result = diagrs.release();
+    if(!counting)
+        label_all(result);
+    return result;
 }
 
 /**
@@ -146,12 +649,13 @@ std::vector< Diagram > Diagram::generate ( int order, int n_legs,
  *  <li> Smaller diagrams before larger diagrams.
  *  <li> Lower-order diagrams before higher-order diagrams.
  *  <li> Simpler flavour splits before more complicated ones.
- *  <li> With everythin else equal, comparisons are made lexicographically
- *       on the labelings. This puts more symmetric diagrams before less 
- *       symmetric ones.
+ *  <li> With everythin else equal, comparisons are made on the first 
+ *       (minimal) labellings.
  * </ol>
  * The particular order of precedence is mainly for aesthetic reasons when 
- * displaying lists of diagrams.
+ * displaying lists of diagrams. Only the first labellings are compared, 
+ * like in @link operator==(const Diagram&, const Diagram&) operator== 
+ * @endlink, so that diagrams are ordered exactly when they are not equal.
  */
 bool operator<(const Diagram& d1, const Diagram& d2){
     if(d1.n_legs != d2.n_legs)
@@ -164,7 +668,7 @@ bool operator<(const Diagram& d1, const Diagram& d2){
     if(d1.flav_split != d2.flav_split)
         return d1.flav_split > d2.flav_split;
     
-    return d1.labellings < d2.labellings;
+    return d1.labellings.front() < d2.labellings.front();
 }
 
 /**
@@ -173,13 +677,50 @@ bool operator<(const Diagram& d1, const Diagram& d2){
  * @param d2    another diagram.
  * @return  @c true only if they have the same size, order, flavour split, and
  *          labelings.
+ * 
+ * All labellings of a diagram are permutations of each other under 
+ * @f$ Z_R, @f$ so two diagrams with the same flavour split have the same 
+ * labellings if and only if they have the same first (minimal) labelling.
+ * Only that is compared, which also lets stripped diagrams 
+ * (see @link Diagram::strip @endlink) be compared to complete ones.
  */
 bool operator==(const Diagram& d1, const Diagram& d2){
     return (d1.n_legs == d2.n_legs) && (d1.order == d2.order)
             && (d1.flav_split == d2.flav_split) 
-            && (d1.labellings == d2.labellings );
+            && (d1.labellings.front() == d2.labellings.front());
 }
 
+/**
+ * @brief Computes a hash value consistent with 
+ * @link operator==(const Diagram&, const Diagram&) operator== @endlink.
+ * 
+ * @return the hash value.
+ * 
+ * Since the labellings are sorted, equal diagrams have equal first 
+ * labellings, and the first labelling is all that needs to be hashed. 
+ * It is the minimal labelling, and thus a canonical form of the diagram.
+ */
+size_t Diagram::hash() const {
+    size_t h = (n_legs << 8) | order;
+    for(int r : flav_split)
+        hash_combine(h, r);
+    if(!labellings.empty())
+        hash_combine(h, labellings.front().hash());
+    return h;
+}
+
+/**
+ * @brief Discards everything about a diagram except what is needed to tell 
+ * it apart from other diagrams and to summarise it.
+ * 
+ * The tree and all labellings but the first are dropped, which leaves the
+ * diagram comparable and hashable, but no longer printable or drawable.
+ */
+void Diagram::strip(){
+    root = DiagramNode();
+    labellings.resize(1);
+    labellings.shrink_to_fit();
+}
 
 /**
  * @brief Left-shift print operator for diagrams.
@@ -197,7 +738,12 @@ std::ostream& operator<<(std::ostream& out, const Diagram& d){
             << d.n_legs << "-point diagram"
             << ", flavour split " << d.flav_split
             << ", " << d.labellings.size() << " distinct labellings"
-            << ":\n\t";
+            << ", symmetry factor ";
+    if(size_t sym = d.symmetry_factor())
+        out << sym;
+    else
+        out << "too large to count";
+    out << ":\n\t";
     
     d.labellings.front().print_header(out);
     for(Labelling lbl : d.labellings )
@@ -295,6 +841,8 @@ int Diagram::summarise(std::ostream& out, const std::vector<Diagram>& diagrs)
     }
     
     TABLE_HLINE
+    
+    return n_singlets;
 }
 
 
@@ -338,20 +886,584 @@ void Diagram::index(){
 /**
  * @brief Generates all distinct labellings on a diagram.
  * 
- * After calling this method, a diagram is complete. It
+ * @param canon if not @c nullptr , the permutations that give the minimal
+ *              (canonical) labelling are put here. 
+ * @param all   if @c false, only the canonical labelling is found. This is
+ *              enough to compare and hash the diagram, and much cheaper for 
+ *              large flavour splits. Calling this method again with @c true 
+ *              completes the diagram.
+ * 
+ * After calling this method with @p all set, a diagram is complete. It
  * requires @link Diagram::index @endlink to work correctly.
  */
-void Diagram::label(){
+void Diagram::label(std::vector<permute::Permutation>* canon, bool all){
+    Labelling id(root, n_legs);
     labellings.clear();
-    labellings.push_back(Labelling(root, n_legs));
+    
+    if(all){
+        orbit(id, labellings);
+        std::sort( labellings.begin(), labellings.end());
+        if(canon)
+            canonical(id, canon);
+    }
+    else
+        labellings.push_back(canonical(id, canon));
+}
+
+/**
+ * @brief Gives each of a list of diagrams all its labellings, sharing the 
+ * work between @link Diagram::set_threads n_threads @endlink threads.
+ * 
+ * @param diagrs    the diagrams, which must be indexed.
+ * 
+ * Each diagram is labelled by a task of its own. A diagram whose group 
+ * @f$ Z_R @f$ has more than a couple of @c LABEL_CHUNK elements, and that has
+ * none of the symmetries looked for by @link Diagram::has_simple_symmetry 
+ * @endlink, is instead split into a task per chunk of ranks (see 
+ * @link Diagram::label_slice @endlink), so that a single large diagram 
+ * keeps all threads busy. The last chunk to finish merges the sorted 
+ * labellings of all chunks. A group too large to rank (see 
+ * @link ZRGroup::order @endlink) cannot be split, so its diagrams are 
+ * labelled by a single task.
+ * 
+ * A diagram without symmetries has as many distinct labellings as 
+ * @f$ Z_R @f$ has elements, each given by a single element, so the merged
+ * labellings are the same as those given by @link Diagram::label @endlink. 
+ * If there are fewer, the diagram has a symmetry after all, and it is 
+ * labelled by @link Diagram::label @endlink instead.
+ */
+void Diagram::label_all(std::vector<Diagram>& diagrs){
+    if(n_threads <= 1){
+        for(Diagram& d : diagrs)
+            d.label();
+        return;
+    }
+    
+    //The labellings found by the chunks of a diagram, and the number of 
+    //chunks that have not finished.
+    struct Chunks {
+        Labelling id;
+        std::vector<std::vector<Labelling>> lbls;
+        std::atomic<size_t> n_left;
+    };
+    auto chunks = std::vector<std::unique_ptr<Chunks>>(diagrs.size());
+    
+    TaskPool pool(n_threads);
+    //Labels chunk c of diagram i, and merges the chunks if it is the last.
+    auto label_chunk = [&](size_t i, size_t c){
+        Diagram& d = diagrs[i];
+        Chunks& ch = *chunks[i];
+        size_t order = ZRGroup::of(d.flav_split).order();
+        d.label_slice(ch.id, c * LABEL_CHUNK, 
+                      std::min(order, (c + 1) * LABEL_CHUNK), ch.lbls[c]);
+        if(--ch.n_left > 0)
+            return;
+        
+        d.labellings.clear();
+        for(std::vector<Labelling>& lbls : ch.lbls){
+            size_t mid = d.labellings.size();
+            d.labellings.insert(d.labellings.end(), 
+                                std::make_move_iterator(lbls.begin()),
+                                std::make_move_iterator(lbls.end()));
+            std::inplace_merge(d.labellings.begin(), 
+                               d.labellings.begin() + mid, 
+                               d.labellings.end());
+        }
+        d.labellings.erase(
+                std::unique(d.labellings.begin(), d.labellings.end()), 
+                d.labellings.end());
+        if(d.labellings.size() < order)
+            d.label();
+        chunks[i].reset();
+    };
+    
+    for(size_t i = 0; i < diagrs.size(); i++){
+        pool.spawn([&, i](){
+            Diagram& d = diagrs[i];
+            size_t order = ZRGroup::of(d.flav_split).order();
+            Labelling id(d.root, d.n_legs);
+            if(order == 0 || order <= 2 * LABEL_CHUNK 
+                    || d.has_simple_symmetry(id)){
+                d.label();
+                return;
+            }
+            
+            size_t n_chunks = (order + LABEL_CHUNK - 1) / LABEL_CHUNK;
+            chunks[i].reset(new Chunks());
+            chunks[i]->id = std::move(id);
+            chunks[i]->lbls.resize(n_chunks);
+            chunks[i]->n_left = n_chunks;
+            for(size_t c = 0; c < n_chunks; c++)
+                pool.spawn([&, i, c](){ label_chunk(i, c); });
+        });
+    }
+    pool.run();
+}
+
+/**
+ * @brief Finds the canonical labelling of a diagram.
+ * 
+ * @param id    the labelling given by the indexing of the diagram.
+ * @param canon if not @c nullptr , the permutations that give the canonical
+ *              labelling are put here.
+ * @return  the canonical labelling, which is the smallest one.
+ * 
+ * A running minimum is kept over the labellings given by 
+ * @link Diagram::visit_labellings @endlink. All other permutations giving
+ * the minimum are found from those visited by applying the symmetries that 
+ * were used to skip them.
+ */
+Labelling Diagram::canonical(const Labelling& id, 
+                             std::vector<permute::Permutation>* canon) const
+{
+    Labelling min = id;
+    auto min_perms = std::vector<permute::Permutation>();
+    auto syms = std::vector<permute::Permutation>();
+    visit_labellings(id, [&](Labelling&& lbl){
+        if(lbl < min){
+            min = std::move(lbl);
+            min_perms.clear();
+            min_perms.push_back(min.permutation());
+        }
+        else if(canon && lbl == min)
+            min_perms.push_back(lbl.permutation());
+    }, canon ? &syms : nullptr);
+    
+    if(!canon)
+        return min;
+    
+    //The group generated by the symmetries is closed by multiplying its 
+    //elements with the generators until nothing new is found.
+    auto key = [](const permute::Permutation& perm){
+        return std::vector<size_t>(perm.begin(), perm.end());
+    };
+    auto group = std::vector<permute::Permutation>(1, 
+            permute::Permutation(n_legs));
+    auto elems = std::set<std::vector<size_t>>();
+    elems.insert(key(group.front()));
+    for(size_t i = 0; i < group.size(); i++){
+        for(const permute::Permutation& sym : syms){
+            permute::Permutation perm = group[i] * sym;
+            if(elems.insert(key(perm)).second)
+                group.push_back(perm);
+        }
+    }
+    
+    canon->clear();
+    elems.clear();
+    for(const permute::Permutation& min_perm : min_perms){
+        for(const permute::Permutation& sym : group){
+            permute::Permutation perm = sym * min_perm;
+            if(elems.insert(key(perm)).second)
+                canon->push_back(perm);
+        }
+    }
+    
+    return min;
+}
+
+/**
+ * @brief Applies enough elements of @f$ Z_R @f$ to a labelling to give every
+ * distinct labelling of the diagram.
+ * 
+ * @param id    the labelling given by the indexing of the diagram.
+ * @param visit called with each labelling in turn. The same labelling may be
+ *              visited several times, and the first one visited equals 
+ *              @p id .
+ * @param syms  if not @c nullptr , the symmetries used to skip elements are
+ *              put here.
+ * 
+ * The elements of @f$ Z_R @f$ are built as a rotation of each trace followed
+ * by an exchange of traces with equally many indices. If @c a is a symmetry 
+ * of the diagram, that is, it maps @p id to itself, then @c g and 
+ * <tt> g * a </tt> give the same labelling, so not all elements need to be 
+ * visited. Two kinds of symmetries are looked for, and used to cut down the
+ * elements as follows:
+ * <ul>
+ *  <li> rotations of a single trace: each trace is only rotated by less than
+ *       the smallest such rotation.
+ *  <li> exchanges of two traces, possibly combined with rotations of them:
+ *       traces that are related by a chain of such exchanges are only placed
+ *       in their original relative order.
+ * </ul>
+ * The latter removes the factorial growth of @f$ Z_R @f$ for diagrams with 
+ * many equivalent traces, such as identical single-vertex branches.
+ * 
+ * Every element of @f$ Z_R @f$ is a visited element times an element of the
+ * group generated by the symmetries that were found.
+ */
+void Diagram::visit_labellings(
+    const Labelling& id, const std::function<void(Labelling&&)>& visit,
+    std::vector<permute::Permutation>* syms) const 
+{
+    size_t n_tr = flav_split.size();
+    const ZRGroup& zr = ZRGroup::of(flav_split);
+    
+    auto is_symmetry = [&](const std::vector<size_t>& dest, 
+                           const std::vector<int>& rot)
+    {
+        permute::Permutation perm = zr.element(dest, rot);
+        if(!(Labelling(id, perm) == id))
+            return false;
         
-    for(permute::ZR_Generator zr(flav_split); zr; ++zr)        
-        labellings.push_back(Labelling( labellings.front(), *zr));
+        if(syms)
+            syms->push_back(perm);
+        return true;
+    };
+    
+    auto ident = std::vector<size_t>(n_tr);
+    std::iota(ident.begin(), ident.end(), 0);
+    auto rot = std::vector<int>(n_tr, 0);
+    
+    //The smallest rotation of each trace that is a symmetry, or the length
+    //of the trace if there is none. All symmetric rotations are multiples 
+    //of it.
+    auto period = std::vector<int>(n_tr);
+    if(syms)
+        syms->clear();
+    for(size_t t = 0; t < n_tr; t++){
+        for(rot[t] = 1; rot[t] < flav_split[t]; rot[t]++){
+            if(is_symmetry(ident, rot))
+                break;
+        }
+        period[t] = rot[t];
+        rot[t] = 0;
+    }
+    
+    //Groups the traces into classes related by symmetric exchanges, each
+    //represented by its first trace. Rotations by a multiple of the period
+    //need not be tried, since they are symmetries.
+    auto cls = ident;
+    auto find = [&cls](size_t t){
+        while(cls[t] != t)
+            t = cls[t];
+        return t;
+    };
+    for(size_t t = 0; t < n_tr; t++){
+        for(size_t s = zr.row(t); s < t; s++){
+            if(find(s) == find(t))
+                continue;
+            
+            auto dest = ident;
+            std::swap(dest[s], dest[t]);
+            bool found = false;
+            for(rot[s] = 0; rot[s] < period[s] && !found; rot[s]++){
+                for(rot[t] = 0; rot[t] < period[t] && !found; rot[t]++)
+                    found = is_symmetry(dest, rot);
+            }
+            rot[s] = rot[t] = 0;
+            
+            if(found)
+                cls[std::max(find(s), find(t))] = std::min(find(s), find(t));
+        }
+    }
+    
+    //The preceding trace in the same class, if any.
+    auto prev = std::vector<int>(n_tr, -1);
+    for(size_t t = 0; t < n_tr; t++){
+        for(size_t s = t; s-- > zr.row(t); ){
+            if(find(s) == find(t)){
+                prev[t] = s;
+                break;
+            }
+        }
+    }
+    
+    //Places the traces in turn, and then tries all rotations. Successive
+    //rotations differ by rotating the blocks of indices that the traces 
+    //were moved to, which is done on a working labelling rather than 
+    //labelling the diagram anew.
+    auto dest = ident;
+    auto used = std::vector<bool>(n_tr, false);
+    std::function<void(size_t)> place = [&](size_t t){
+        if(t == n_tr){
+            Labelling lbl(id, zr.element(dest, rot));
+            for(;;){
+                visit(Labelling(lbl));
+                
+                size_t r = 0;
+                for(; r < n_tr && rot[r] + 1 == period[r]; r++){
+                    lbl.rotate(zr.offset(dest[r]), flav_split[r], 
+                               (flav_split[r] - rot[r]) % flav_split[r]);
+                    rot[r] = 0;
+                }
+                if(r == n_tr)
+                    return;
+                
+                rot[r]++;
+                lbl.rotate(zr.offset(dest[r]), flav_split[r], 1);
+            }
+        }
         
-    std::sort( labellings.begin(), labellings.end());
-    std::vector<Labelling>::iterator last 
-            = std::unique( labellings.begin(), labellings.end());
-    labellings.resize(std::distance( labellings.begin(), last));
+        for(size_t u = zr.row(t); u < n_tr && flav_split[u] == flav_split[t]; 
+                u++){
+            if(used[u] || (prev[t] >= 0 && u < dest[prev[t]]))
+                continue;
+            
+            used[u] = true;
+            dest[t] = u;
+            place(t + 1);
+            used[u] = false;
+        }
+    };
+    place(0);
+}
+
+/**
+ * @brief Finds all permutations that give the canonical labelling of a 
+ * labelled diagram.
+ * 
+ * @return the permutations in @f$ Z_R @f$ that, applied to the identity 
+ *      labelling, give the minimal labelling. They form a coset of the
+ *      symmetry group of the diagram.
+ * 
+ * This gives the same permutations as @link Diagram::label @endlink, but 
+ * works on a complete diagram without changing it.
+ */
+std::vector<permute::Permutation> Diagram::canonical_perms() const {
+    auto canon = std::vector<permute::Permutation>();
+    canonical(Labelling::identity(root, n_legs), &canon);
+    return canon;
+}
+
+/**
+ * @brief Finds all distinct labellings of a diagram by following the orbit 
+ * of one of them under @f$ Z_R. @f$
+ * 
+ * @param id    the labelling given by the indexing of the diagram.
+ * @param lbls  the distinct labellings are put here, each exactly once and 
+ *              unsorted, starting with one equal to @p id .
+ * 
+ * The labellings found so far are acted on in turn by a set of generators of
+ * @f$ Z_R @f$: the rotation of each trace by one step, and the exchange of
+ * each pair of neighbouring traces of equal length. Each new labelling is 
+ * kept together with the element that gives it. Since two elements give the
+ * same labelling exactly when they differ by a symmetry of the diagram, 
+ * this keeps one element from each coset of the symmetry group (the 
+ * stabiliser of @p id ), and the cost is proportional to the number of
+ * distinct labellings rather than to the order of @f$ Z_R. @f$
+ * 
+ * Most of the labellings reached this way have been found before. Their
+ * propagators are hashed and looked up as they come out of the permutation,
+ * and only those of new labellings are sorted into a labelling.
+ */
+void Diagram::orbit(const Labelling& id, std::vector<Labelling>& lbls) const {
+    const std::vector<permute::Permutation>& gens 
+        = ZRGroup::of(flav_split).generators();
+    
+    lbls.clear();
+    lbls.push_back(Labelling(id, permute::Permutation(n_legs)));
+    auto found = std::unordered_multimap<size_t, size_t>();
+    found.insert(std::make_pair(lbls.front().hash(), 0));
+    
+    auto props = std::vector<Propagator>();
+    for(size_t i = 0; i < lbls.size(); i++){
+        for(const permute::Permutation& gen : gens){
+            permute::Permutation perm = lbls[i].permutation() * gen;
+            id.relabel(perm, props);
+            size_t h = Labelling::hash(props);
+            
+            auto range = found.equal_range(h);
+            auto it = range.first;
+            for(; it != range.second && !lbls[it->second].has_props(props); 
+                ++it);
+            
+            if(it == range.second){
+                found.insert(std::make_pair(h, lbls.size()));
+                lbls.push_back(Labelling(perm, std::move(props)));
+                props = std::vector<Propagator>();
+            }
+        }
+    }
+}
+
+/**
+ * @brief Applies a slice of @f$ Z_R @f$ to a labelling.
+ * 
+ * @param id    the labelling given by the indexing of the diagram.
+ * @param first the rank of the first element of the slice, in the order of
+ *              @link permute::ZR_Generator @endlink.
+ * @param last  the rank after the last element of the slice.
+ * @param lbls  the distinct labellings given by the elements are put here,
+ *              sorted.
+ * 
+ * Slices can be labelled independently, and together give the same 
+ * labellings as @link Diagram::orbit @endlink, although not necessarily with
+ * the same permutations.
+ */
+void Diagram::label_slice(const Labelling& id, size_t first, size_t last,
+                          std::vector<Labelling>& lbls) const 
+{
+    permute::ZR_Generator gen(flav_split);
+    gen.seek(first);
+    
+    lbls.clear();
+    lbls.reserve(last - first);
+    for(size_t r = first; r < last; r++, ++gen)
+        lbls.push_back(Labelling(id, *gen));
+    
+    std::sort(lbls.begin(), lbls.end());
+    lbls.erase(std::unique(lbls.begin(), lbls.end()), lbls.end());
+}
+
+/**
+ * @brief Looks for the most common kinds of symmetry of a diagram.
+ * 
+ * @param id    the labelling given by the indexing of the diagram.
+ * @return  @c true if a rotation of a single trace, or an exchange of two 
+ *      traces combined with rotations of them, maps @p id to itself.
+ * 
+ * Only a few elements of @f$ Z_R @f$ are tried, so this tells cheaply 
+ * whether the diagram has far fewer labellings than @f$ Z_R @f$ has 
+ * elements. 
+ */
+bool Diagram::has_simple_symmetry(const Labelling& id) const {
+    size_t n_tr = flav_split.size();
+    const ZRGroup& zr = ZRGroup::of(flav_split);
+    
+    auto dest = std::vector<size_t>(n_tr);
+    std::iota(dest.begin(), dest.end(), 0);
+    auto rot = std::vector<int>(n_tr, 0);
+    auto is_symmetry = [&](){
+        return Labelling(id, zr.element(dest, rot)) == id;
+    };
+    
+    for(size_t t = 0; t < n_tr; t++){
+        for(rot[t] = 1; rot[t] < flav_split[t]; rot[t]++){
+            if(is_symmetry())
+                return true;
+        }
+        rot[t] = 0;
+    }
+    
+    for(size_t t = 0; t < n_tr; t++){
+        for(size_t s = zr.row(t); s < t; s++){
+            std::swap(dest[s], dest[t]);
+            for(rot[s] = 0; rot[s] < flav_split[s]; rot[s]++){
+                for(rot[t] = 0; rot[t] < flav_split[t]; rot[t]++){
+                    if(is_symmetry())
+                        return true;
+                }
+            }
+            rot[s] = rot[t] = 0;
+            std::swap(dest[s], dest[t]);
+        }
+    }
+    
+    return false;
+}
+
+/**
+ * @brief Computes the symmetry factor of a complete diagram.
+ * 
+ * @return the number of elements of @f$ Z_R @f$ that map a labelling of the 
+ *      diagram to itself. By the orbit-stabiliser theorem, this is the order
+ *      of @f$ Z_R @f$ divided by the number of distinct labellings, or 0 
+ *      if the order does not fit in a @c size_t .
+ */
+size_t Diagram::symmetry_factor() const {
+    return ZRGroup::of(flav_split).order() / labellings.size();
+}
+
+/**
+ * @brief Checks whether a vertex could have been the last one attached when 
+ * generating a diagram.
+ * 
+ * @param w     a vertex connected to the rest of the diagram by a single 
+ *              propagator.
+ * @param tree  a flat copy of the diagram's tree, from which a copy 
+ *              without @p w is made.
+ * @return @c true if removing @p w leaves a diagram in one of the sets that
+ *      are extended by the generation (see @link Diagram::subproblems 
+ *      @endlink), and attaching @p w to it obeys the rules for singlet 
+ *      propagators used by @link Diagram::extension_sites @endlink and 
+ *      @link Diagram::attach @endlink.
+ * 
+ * If the diagram has singlet propagators, the generation must have had them
+ * enabled, so that need not be checked.
+ * 
+ * Vertices whose removal leaves an identically zero diagram are not counted 
+ * as removable. The labellings of such diagrams do not always tell apart all
+ * trees that differ in how singlet propagators and single-index traces are 
+ * arranged, so the diagram kept for such a set need not be the tree that
+ * this diagram was built from.
+ */
+bool Diagram::removable(const DiagramNode::LeafVertex& w, 
+                        const FlatTree& tree) const 
+{
+    int o = order - (w.order - 2), n = n_legs - (w.n_legs - 2);
+    
+    auto subs = subproblems(order, n_legs);
+    if(std::find(subs.begin(), subs.end(), std::make_pair(o, n)) == subs.end())
+        return false;
+    
+    if(w.singlet && !(o > 2 && order > 4 
+            && w.neighbour_order > 2 && w.order > 2 && w.split > 2))
+        return false;
+    
+    FlatTree rest(tree);
+    rest.without(w);
+    auto rest_split = std::vector<int>();
+    rest.find_flav_split(rest_split);
+    if(std::find(rest_split.begin(), rest_split.end(), 1) != rest_split.end())
+        return false;
+    
+    return o < 6 || !rest.is_zero();
+}
+
+/**
+ * @brief Checks whether the last vertex attached to a diagram is its 
+ * canonical last vertex. This is the acceptance test of orderly generation.
+ * 
+ * @param where the location of the attached vertex, as given to 
+ *              @link Diagram::attach @endlink.
+ * @param canon the permutations giving the canonical labelling, as found by
+ *              @link Diagram::label @endlink.
+ * @return @c true if the attached vertex is equivalent under the symmetries
+ *      of the diagram to its canonical last vertex.
+ * 
+ * Among all vertices that the diagram could have been built by attaching
+ * last (see @link Diagram::removable @endlink), the canonical one is that
+ * whose external legs have the smallest indices in the canonical labelling.
+ * Since all permutations in @p canon differ by a symmetry, each vertex is
+ * keyed by its smallest leg set over all of them, which makes equivalent
+ * vertices share keys.
+ * 
+ * Diagrams without any removable vertex are always accepted, and are instead
+ * deduplicated like in ordinary generation. @link Diagram::attach @endlink
+ * does the same for diagrams with singlet propagators, since their 
+ * labellings do not always tell apart the trees they could be built as.
+ */
+bool Diagram::canonical_extension(
+    const std::vector<std::pair<int, int>>& where, 
+    const std::vector<permute::Permutation>& canon) const
+{
+    auto bit_canon = std::vector<permute::BitPermutation<mmask>>(
+            canon.begin(), canon.end());
+    auto key = [&bit_canon](mmask legs){
+        mmask min = ~((mmask) 0);
+        for(const permute::BitPermutation<mmask>& perm : bit_canon)
+            min = std::min(min, perm(legs));
+        return min;
+    };
+    
+    auto verts = std::vector<DiagramNode::LeafVertex>();
+    auto traversal = std::vector<std::pair<int, int>>();
+    root.leaf_vertices(verts, traversal);
+    FlatTree tree(root);
+    
+    mmask min = ~((mmask) 0), new_key = 0;
+    bool any_removable = false;
+    for(const DiagramNode::LeafVertex& w : verts){
+        if(w.where == where)
+            new_key = key(w.momenta);
+        if(removable(w, tree)){
+            min = std::min(min, key(w.momenta));
+            any_removable = true;
+        }
+    }
+    
+    return !any_removable || new_key == min;
 }
 
 /**
@@ -363,48 +1475,94 @@ void Diagram::label(){
  * @return a vector containing diagrams representing all ways to attach 
  * the new vertices to legs of the diagram.
  * 
- * This method is central to the diagram generation process. In order to
- * reduce the number of redundant diagrams, only legs that, in some
- * distinct labelling of the diagram, carry a label that is a coset
- * representative under @f$  Z_R,@f$ are extended. The generated
- * diagrams are completely set up and labelled.
+ * This method is central to the diagram generation process. The legs that
+ * are extended are those given by @link Diagram::extension_sites @endlink.
+ * The generated diagrams are completely set up and labelled.
  */
 std::vector<Diagram> Diagram::extend(
-    const std::vector<vertex>& new_verts, bool singlets, bool debug)
+    const std::vector<vertex>& new_verts, bool singlets, bool debug) const
 {
-    
-    //A vector of representatives taken from each equivalence class of indices
-    //under Z_R. The representative is the smallest index in each trace that is
-    //either the first trace (index 0) or larger than the preceding trace.
-    auto idx_reps = std::vector<int>();
-    idx_reps.push_back(0);
-    for(int i = 1, idx = flav_split[0]; 
-            i < flav_split.size(); 
-            i++, idx += flav_split[i])
-    {
-        if(flav_split[i] != flav_split[i-1])
-            idx_reps.push_back(idx);
+    auto diagrs = std::vector<Diagram>();
+    for(const site& s : extension_sites(singlets, debug)){
+        for(const vertex& v : new_verts)
+            attach(v, s.first, diagrs, s.second && (v.first > 2), debug);
     }
     
-    //All locations in the diagram where, in some labeling, an index
-    //representative occurs, are marked as distinct places to put a new vertex.
+    for(Diagram& d : diagrs)
+        d.label();
+    return diagrs;
+}
+
+/**
+ * @brief Finds the legs of a diagram at which new vertices should be 
+ * attached.
+ * 
+ * @param singlets enables singlet propagators.
+ * @param debug enables debug messages.
+ * @param symmetric if @c true, the legs are chosen as for orderly generation.
+ * @return the locations of the legs, in the order of a depth-first 
+ * traversal of the diagram, each with a flag telling whether singlet 
+ * propagators can be attached there.
+ * 
+ * In order to reduce the number of redundant diagrams, only legs that, in some
+ * distinct labelling of the diagram, carry a label that is a coset
+ * representative under @f$  Z_R,@f$ are extended. With @p symmetric, exactly
+ * one leg from each class of legs related by a symmetry of the diagram is 
+ * extended instead.
+ */
+std::vector<site> Diagram::extension_sites(
+    bool singlets, bool debug, bool symmetric) const 
+{
     auto rep_locs = std::unordered_set<int>();
-    for(Labelling& lbl : labellings ){
-        auto idx_loc = lbl.index_locations();
-        for(int rep : idx_reps)
-            rep_locs.insert(idx_loc[rep]);
+    if(symmetric){
+        //One leg is taken from each class of legs that are equivalent under
+        //the symmetries of the diagram. Two legs are equivalent if they get 
+        //the same smallest index under the permutations giving the 
+        //canonical labelling, since those differ only by symmetries.
+        auto keys = std::unordered_set<mmask, mmask_hash>();
+        auto canon = canonical_perms();
+        for(int i = 0; i < n_legs; i++){
+            mmask min = ~((mmask) 0);
+            for(const permute::Permutation& perm : canon)
+                min = std::min(min, perm.permute_bits<mmask>(((mmask) 1) << i));
+            
+            if(keys.insert(min).second)
+                rep_locs.insert(i);
+        }
+    }
+    else{
+        //A vector of representatives taken from each equivalence class of 
+        //indices under Z_R. The representative is the smallest index in each 
+        //trace that is either the first trace (index 0) or larger than the 
+        //preceding trace.
+        auto idx_reps = std::vector<int>();
+        idx_reps.push_back(0);
+        int idx = flav_split[0];
+        for(size_t i = 1; i < flav_split.size(); idx += flav_split[i], i++)
+        {
+            if(flav_split[i] != flav_split[i-1])
+                idx_reps.push_back(idx);
+        }
+
+        //All locations in the diagram where, in some labeling, an index
+        //representative occurs, are marked as distinct places to put a new 
+        //vertex.
+        for(const Labelling& lbl : labellings ){
+            auto idx_loc = lbl.index_locations();
+            for(int rep : idx_reps)
+                rep_locs.insert(idx_loc[rep]);
+        }
     }
     
     if(debug)
         std::cout << "\tAttaching extension to legs " << rep_locs << std::endl;
     
-    //Traverses the diagram and attaches all new vertices at all marked 
-    //locations
-    auto diagrs = std::vector<Diagram>();
+    //Traverses the diagram and collects all marked locations
+    auto sites = std::vector<site>();
     auto traversal = std::vector<std::pair<int,int>>();
-    root.extend(diagrs, new_verts, rep_locs, traversal, *this, singlets, debug);
+    root.extension_sites(sites, rep_locs, traversal, singlets);
         
-    return diagrs;
+    return sites;
 }
 
 /**
@@ -416,57 +1574,60 @@ std::vector<Diagram> Diagram::extend(
  * @param diagrs the list of diagrams to which the new diagrams are added.
  * @param singlet enables attaching the leg via a singlet propagator.
  * @param debug enables debug printouts.
+ * @param filter if not @c nullptr, diagrams not admitted by it are discarded
+ * before they are labelled. Diagrams that stay zero (see 
+ * @link Diagram::stays_zero @endlink) are always discarded.
+ * @param ordinary enables attaching the leg via an ordinary propagator.
  *
- * This method serves as an auxiliary to @link Diagram::attach @endlink.
+ * This method serves as an auxiliary to @link Diagram::extend @endlink.
  * Several diagrams are generated: different choices of vertex leg to attach,
  * and singlet/ordinary propagator. The generated diagrams are completely set
- * up and labelled.
+ * up, but only given their canonical labelling (see @link Diagram::label 
+ * @endlink), since most of them turn out to be duplicates.
  */
 void Diagram::attach(
     const vertex& new_vert,
     const std::vector<std::pair<int,int> >& where, 
     std::vector<Diagram>& diagrs, 
-    bool singlet, bool debug)
+    bool singlet, bool debug, const FlavSplitFilter* filter, bool ordinary)
 const {
+    auto canon = std::vector<permute::Permutation>();
     for(int i = 0; i < new_vert.second.size(); i++){
         if(i > 0 && new_vert.second[i] == new_vert.second[i-1])
             continue;
         
-        Diagram d(*this);
-        d.order += new_vert.first - 2;
-        
-        if(debug){
-            std::cout   << "\tAttaching O(p^" << new_vert.first 
-                        << ") vertex with flavour split " << new_vert.second
-                        << " at location " << where << std::endl;
+        if(ordinary){
+            if(debug){
+                std::cout   << "\tAttaching O(p^" << new_vert.first 
+                            << ") vertex with flavour split " << new_vert.second
+                            << " at location " << where << std::endl;
+            }
+            Diagram d(*this, new_vert, i, where, false);
+            if((!filter || filter->admits(d.flav_split)) && !d.stays_zero()){
+                d.index();
+                d.label(orderly ? &canon : nullptr, false);
+
+                //Singlet diagrams are always kept, see canonical_extension
+                if(!orderly || d.singlet_diagram 
+                        || d.canonical_extension(where, canon))
+                    diagrs.push_back(std::move(d));
+            }
         }
-        d.root.attach(new_vert, i, where, 0, false, debug);
-        d.singlet_diagram = this->singlet_diagram;
-        
-        d.find_flav_split();
-        d.index();
-        d.label();
-        
-        
-        diagrs.push_back(d);
         
         if(singlet && new_vert.second[i] > 2){
-            Diagram s(*this);
-            s.order += new_vert.first - 2;
-        
             if(debug){
                 std::cout   << "\tSinglet-attaching O(p^" << new_vert.first 
                             << ") vertex with flavour split " << new_vert.second
                             << " at location " << where << std::endl;
             }
-            s.root.attach(new_vert, i, where, 0, true, debug);
-            s.singlet_diagram = true;
+            Diagram s(*this, new_vert, i, where, true);
             
-            s.find_flav_split();
+            if((filter && !filter->admits(s.flav_split)) || s.stays_zero())
+                continue;
             s.index();
-            s.label();
+            s.label(nullptr, false);
             
-            diagrs.push_back(s);
+            diagrs.push_back(std::move(s));
         }
     }
 }
@@ -475,39 +1636,97 @@ const {
  * @brief Filters a list of diagrams based on their flavour structure.
  * 
  * @param diagrs    the diagrams, all of which should have the same number of legs. 
- * @param filter    a vector of flavour splits: ascendingly sorted vectors of 
- *                  integers larger than 1 that sum to the number of legs on the
- *                  diagrams.
- * @param include   if @c true, all diagrams that match the filter are kept, and
- *                  all others are discarded. If @c false, the opposite happens.
+ * @param filter    the flavour splits to keep or remove.
  * @return the number of diagrams removed. 
  */
 size_t Diagram::filter_flav_split(std::vector<Diagram>& diagrs, 
-                                    const std::vector<std::vector<int> >& filter, 
-                                    bool include)
+                                  const FlavSplitFilter& filter)
 {
     auto tmp = std::vector<Diagram>();
     size_t init_size = diagrs.size();
     
     for(Diagram& d : diagrs){
-        for(const std::vector<int>& flav_split : filter){
-            if(flav_split == d.flav_split){
-                if(include)            
-                    tmp.push_back(d);
-                
-                break;
-            }
-        }
-        if(!include)
-            tmp.push_back(d);
+        if(filter.admits(d.flav_split))
+            tmp.push_back(std::move(d));
     }
     
-    diagrs.clear();
-    diagrs.insert(diagrs.cend(), tmp.begin(), tmp.end());
+    diagrs = std::move(tmp);
     
     return init_size - diagrs.size();
 }
 
+/**
+ * @brief Checks whether a filter lets through a flavour split.
+ * 
+ * @param flav_split    a sorted flavour split.
+ * @return @c true if diagrams with the flavour split should be kept.
+ */
+bool Diagram::FlavSplitFilter::admits(const std::vector<int>& flav_split) 
+const {
+    bool found = std::find(splits.begin(), splits.end(), flav_split) 
+                    != splits.end();
+    return found == include;
+}
+
+/**
+ * @brief Checks whether attaching a vertex to a diagram can give a diagram
+ * that passes a filter.
+ * 
+ * @param flav_split    the flavour split of the diagram.
+ * @param new_vert      the vertex.
+ * @param singlet       whether the vertex may be attached via a singlet
+ *                      propagator.
+ * @param filter        the filter.
+ * @return @c false only if no way of attaching the vertex passes.
+ * 
+ * The flavour split of the result follows from the splits alone. The leg 
+ * that the vertex is attached to is in some trace of size @f$ r @f$ , and
+ * the vertex leg that is attached is in a trace of size @f$ s @f$. An 
+ * ordinary propagator joins them into one trace of size @f$ r + s - 2 @f$, 
+ * while a singlet propagator leaves traces of sizes @f$ r - 1 @f$ and 
+ * @f$ s - 1 @f$ (the former dropped if empty). The other traces of both 
+ * are unchanged. All choices of @f$ r @f$ and @f$ s @f$ are tried, which
+ * is cheap compared to attaching and labelling.
+ */
+bool Diagram::can_reach(const std::vector<int>& flav_split, 
+    const vertex& new_vert, bool singlet, const FlavSplitFilter& filter)
+{
+    auto admits = [&](std::vector<int> split, int r, int s, 
+                      std::initializer_list<int> joined)
+    {
+        split.erase(std::find(split.begin(), split.end(), r));
+        for(int t : new_vert.second)
+            split.push_back(t);
+        split.erase(std::find(split.begin(), split.end(), s));
+        for(int t : joined){
+            if(t > 0)
+                split.push_back(t);
+        }
+        
+        std::sort(split.begin(), split.end());
+        return filter.admits(split);
+    };
+    
+    for(size_t i = 0; i < flav_split.size(); i++){
+        if(i > 0 && flav_split[i] == flav_split[i-1])
+            continue;
+        int r = flav_split[i];
+        
+        for(size_t j = 0; j < new_vert.second.size(); j++){
+            if(j > 0 && new_vert.second[j] == new_vert.second[j-1])
+                continue;
+            int s = new_vert.second[j];
+            
+            if(admits(flav_split, r, s, {r + s - 2}))
+                return true;
+            if(singlet && s > 2 && admits(flav_split, r, s, {r - 1, s - 1}))
+                return true;
+        }
+    }
+    
+    return false;
+}
+
 
 /**
  * @brief Generates a list of all valid flavour splits of a given vertex.
@@ -0,0 +1,307 @@
+/*
+ * File:   DiagramCache.cpp
+ *
+ * Implements DiagramCache.hpp
+ */
+
+#include "DiagramCache.hpp"
+#include "binary.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <unistd.h>
+
+/** Identifies the cache files. */
+#define CACHE_MAGIC "FODGE diagram cache"
+/** Written in host byte order to detect files from incompatible machines. */
+#define CACHE_BYTE_ORDER ((uint32_t) 0x01020304)
+/** Changed whenever the layout of the files or the contents of the generated 
+ *  sets change, including which tree or permutations represent a diagram. */
+#define CACHE_FORMAT ((uint32_t) 4)
+
+std::map<DiagramCache::key, std::vector<Diagram>> DiagramCache::sets = {};
+size_t DiagramCache::n_hits   = 0;
+size_t DiagramCache::n_misses = 0;
+
+std::string DiagramCache::directory = "";
+size_t DiagramCache::n_loads = 0;
+size_t DiagramCache::n_saves = 0;
+
+/**
+ * @brief Looks up a previously generated set of diagrams.
+ *
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @param singlets  whether singlet diagrams are included.
+ * @return  a pointer to the stored set, or @c nullptr if it has not been
+ *          generated yet. The pointer stays valid until
+ *          @link DiagramCache::clear @endlink is called.
+ */
+const std::vector<Diagram>* DiagramCache::lookup(
+    int order, int n_legs, bool singlets)
+{
+    auto it = sets.find(key(order, n_legs, singlets));
+    if(it != sets.end()){
+        n_hits++;
+        return &(it->second);
+    }
+    
+    auto diagrs = std::vector<Diagram>();
+    if(load(order, n_legs, singlets, diagrs)){
+        n_hits++;
+        return &(sets.insert(std::make_pair(key(order, n_legs, singlets), 
+                                            std::move(diagrs))).first->second);
+    }
+    
+    n_misses++;
+    return nullptr;
+}
+
+/**
+ * @brief Stores a newly generated set of diagrams.
+ *
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @param singlets  whether singlet diagrams are included.
+ * @param diagrs    the diagrams, as produced by the generation.
+ * @return  a reference to the stored set, which stays valid until
+ *          @link DiagramCache::clear @endlink is called.
+ *
+ * If a set is already stored under the same key, it is kept and @p diagrs
+ * is discarded. Otherwise, the set is also saved to the cache directory,
+ * if one is set.
+ */
+const std::vector<Diagram>& DiagramCache::store(
+    int order, int n_legs, bool singlets, std::vector<Diagram>&& diagrs)
+{
+    if(sets.find(key(order, n_legs, singlets)) == sets.end())
+        save(order, n_legs, singlets, diagrs);
+    
+    return sets.insert(std::make_pair(
+            key(order, n_legs, singlets), std::move(diagrs))).first->second;
+}
+
+/**
+ * @brief Removes all stored sets and resets the hit and miss counters.
+ *
+ * All pointers and references previously handed out become invalid.
+ * The cache directory and its contents are left untouched.
+ */
+void DiagramCache::clear(){
+    sets.clear();
+    n_hits = 0;
+    n_misses = 0;
+    n_loads = 0;
+    n_saves = 0;
+}
+
+/**
+ * @brief Sets the directory in which diagram sets are stored between runs.
+ * 
+ * @param dir   the directory, which must already exist. An empty string 
+ *              disables the on-disk cache.
+ */
+void DiagramCache::set_directory(const std::string& dir){
+    directory = dir;
+    if(!directory.empty() && directory.back() != '/')
+        directory.push_back('/');
+}
+
+/**
+ * @brief Checks whether a valid cache file exists for a set of diagrams, 
+ * without reading the diagrams.
+ * 
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @param singlets  whether singlet diagrams are included.
+ * @return  @c true if the set can be loaded from the cache directory.
+ */
+bool DiagramCache::on_disk(int order, int n_legs, bool singlets){
+    if(directory.empty())
+        return false;
+    
+    std::ifstream in(filename(order, n_legs, singlets), std::ios::binary);
+    size_t size;
+    return in && read_header(in, order, n_legs, singlets, size);
+}
+
+/**
+ * @brief Reads a set of diagrams from the cache directory.
+ * 
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @param singlets  whether singlet diagrams are included.
+ * @param diagrs    the diagrams are put here, replacing its contents.
+ * @return  @c true if the set was read, @c false if there is no cache 
+ *          directory or no valid file for the set. Invalid files are
+ *          reported to @c cerr and otherwise ignored.
+ */
+bool DiagramCache::load(int order, int n_legs, bool singlets, 
+                        std::vector<Diagram>& diagrs)
+{
+    if(directory.empty())
+        return false;
+    
+    std::string fname = filename(order, n_legs, singlets);
+    std::ifstream in(fname, std::ios::binary);
+    if(!in)
+        return false;
+    
+    size_t size;
+    if(!read_header(in, order, n_legs, singlets, size)){
+        std::cerr << "WARNING: ignoring outdated or foreign cache file \"" 
+                  << fname << "\"\n";
+        return false;
+    }
+    
+    diagrs.clear();
+    //A corrupted size is only caught when the file runs out
+    diagrs.reserve(std::min(size, (size_t) 1 << 24));
+    for(size_t i = 0; i < size; i++){
+        diagrs.push_back(Diagram());
+        if(!diagrs.back().read(in)){
+            std::cerr << "WARNING: ignoring corrupted cache file \"" 
+                      << fname << "\"\n";
+            diagrs.clear();
+            return false;
+        }
+    }
+    
+    n_loads++;
+    return true;
+}
+
+/**
+ * @brief Writes a set of diagrams to the cache directory.
+ * 
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @param singlets  whether singlet diagrams are included.
+ * @param diagrs    the diagrams.
+ * @return  @c true if the set was written, @c false if there is no cache 
+ *          directory or the file could not be written. Failures are reported 
+ *          to @c cerr but are otherwise harmless.
+ * 
+ * The set is written to a temporary file which is then renamed, so that an
+ * interrupted run never leaves a truncated file under the final name. The 
+ * temporary name is unique to the process and the call, so that runs 
+ * sharing a cache directory never write to the same temporary file.
+ */
+bool DiagramCache::save(int order, int n_legs, bool singlets, 
+                        const std::vector<Diagram>& diagrs)
+{
+    if(directory.empty())
+        return false;
+    
+    static size_t n_tmp = 0;
+    
+    std::string fname = filename(order, n_legs, singlets);
+    std::ostringstream tmp;
+    tmp << fname << "." << getpid() << "." << n_tmp++ << ".tmp";
+    std::string tmp_fname = tmp.str();
+    std::ofstream out(tmp_fname, std::ios::binary | std::ios::trunc);
+    
+    binary::write(out, std::string(CACHE_MAGIC));
+    binary::write(out, std::string(FODGE_VERSION));
+    binary::write(out, CACHE_FORMAT);
+    binary::write(out, CACHE_BYTE_ORDER);
+    binary::write(out, (uint8_t) sizeof(mmask));
+    binary::write(out, (int32_t) order);
+    binary::write(out, (int32_t) n_legs);
+    binary::write(out, (uint8_t) singlets);
+    binary::write(out, (uint8_t) Diagram::is_orderly());
+    binary::write_size(out, diagrs.size());
+    
+    for(const Diagram& d : diagrs)
+        d.write(out);
+    
+    out.close();
+    if(out.fail() || std::rename(tmp_fname.c_str(), fname.c_str())){
+        std::cerr << "WARNING: failed to write cache file \"" 
+                  << fname << "\"\n";
+        std::remove(tmp_fname.c_str());
+        return false;
+    }
+    
+    n_saves++;
+    return true;
+}
+
+/**
+ * @brief Constructs the name of the cache file for a set of diagrams.
+ * 
+ * @param order     the order of the diagrams.
+ * @param n_legs    the number of legs on the diagrams.
+ * @param singlets  whether singlet diagrams are included.
+ * @return  the filename, including the directory. Builds with other than 
+ *          32-bit momentum masks use names of their own, so that they do not 
+ *          overwrite each other's files, and so do orderly runs, which keep 
+ *          other representatives of the diagrams.
+ */
+std::string DiagramCache::filename(int order, int n_legs, bool singlets){
+    std::ostringstream fname;
+    fname << directory << "M" << n_legs << "p" << order 
+          << (singlets ? "_singlets" : "");
+    if(FODGE_MMASK_BITS != 32)
+        fname << "_m" << FODGE_MMASK_BITS;
+    if(Diagram::is_orderly())
+        fname << "_orderly";
+    fname << ".fdc";
+    return fname.str();
+}
+
+/**
+ * @brief Reads and validates the header of a cache file.
+ * 
+ * @param in        a stream to the file.
+ * @param order     the expected order of the diagrams.
+ * @param n_legs    the expected number of legs on the diagrams.
+ * @param singlets  the expected singlet setting.
+ * @param size      the number of diagrams in the file is put here.
+ * @return  @c true if the file matches the expected key, this version of
+ *          FODGE, this machine and the generation mode (see 
+ *          @link Diagram::set_orderly @endlink).
+ */
+bool DiagramCache::read_header(std::istream& in, int order, int n_legs, 
+                               bool singlets, size_t& size)
+{
+    //Any longer string would not match anyway
+    std::string magic, version;
+    binary::read(in, magic, sizeof(CACHE_MAGIC));
+    if(!in || magic != CACHE_MAGIC)
+        return false;
+    binary::read(in, version, 1 << 8);
+    
+    bool valid = (version == FODGE_VERSION)
+        && (binary::read<uint32_t>(in) == CACHE_FORMAT)
+        && (binary::read<uint32_t>(in) == CACHE_BYTE_ORDER)
+        && (binary::read<uint8_t>(in) == sizeof(mmask))
+        && (binary::read<int32_t>(in) == order)
+        && (binary::read<int32_t>(in) == n_legs)
+        && (binary::read<uint8_t>(in) == singlets)
+        && (binary::read<uint8_t>(in) == Diagram::is_orderly());
+    
+    size = binary::read_size(in, binary::MAX_SIZE);
+    return valid && in;
+}
+
+/**
+ * @brief Prints a one-line summary of the cache usage.
+ *
+ * @param out the stream to which the summary is printed.
+ */
+void DiagramCache::report(std::ostream& out){
+    size_t n_diagrs = 0;
+    for(auto& key_val : sets)
+        n_diagrs += key_val.second.size();
+
+    out << "Diagram cache: " << sets.size() << " sets (" << n_diagrs
+        << " diagrams), " << n_hits << " hits, " << n_misses << " misses";
+    if(!directory.empty()){
+        out << ", " << n_loads << " sets loaded from and " << n_saves 
+            << " saved to \"" << directory << "\"";
+    }
+    out << "\n";
+}
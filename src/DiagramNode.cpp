@@ -90,21 +90,24 @@ DiagramNode::DiagramNode(
  * found, after which the result is propagated back to the
  * root. The return value of the root determines the status
  * of the entire diagram.
+ *
+ * The propagator to the parent counts as a leg of the
+ * connected flavour trace, so the result is the same
+ * whichever vertex is the root.
  */
-bool DiagramNode::is_zero(){
+bool DiagramNode::is_zero() const {
     if(is_leaf)
         return false;
     
-    if(traces[0].legs.size() == 1 
-            && (is_singlet != traces[0].legs[0].is_singlet))
-        return true;
-        
-    for(FlavourTrace tr : traces){
-        if(tr.legs.size() == 2 
+    for(const FlavourTrace& tr : traces){
+        if(tr.connected && tr.legs.size() == 1
+                && (is_singlet != tr.legs[0].is_singlet))
+            return true;
+        if(!tr.connected && tr.legs.size() == 2 
                 && (tr.legs[0].is_singlet != tr.legs[1].is_singlet))
             return true;
         
-        for(DiagramNode leg : tr.legs){
+        for(const DiagramNode& leg : tr.legs){
             if(leg.is_zero())
                 return true;
         }
@@ -113,6 +116,42 @@ bool DiagramNode::is_zero(){
     return false;
 }
     
+/**
+ * @brief Checks if a node renders a diagram zero in a way that no further
+ * extension of the diagram can undo.
+ * 
+ * @return @c true if @link DiagramNode::is_zero @endlink is @c true for this
+ * diagram and for every diagram made from it by attaching vertices.
+ *
+ * This is the case if a singlet and an ordinary propagator make up some
+ * two-leg flavour trace (counting the propagator to the parent). Attaching a
+ * vertex replaces an external leg, so the traces of every existing vertex,
+ * and the kind of every existing propagator, stay the same. Zero patterns
+ * that involve an external leg are left alone, since the leg can still
+ * become a propagator.
+ */
+bool DiagramNode::stays_zero() const {
+    if(is_leaf)
+        return false;
+
+    for(const FlavourTrace& tr : traces){
+        if(tr.connected && tr.legs.size() == 1 && !tr.legs[0].is_leaf
+                && (is_singlet != tr.legs[0].is_singlet))
+            return true;
+        if(!tr.connected && tr.legs.size() == 2 
+                && !tr.legs[0].is_leaf && !tr.legs[1].is_leaf
+                && (tr.legs[0].is_singlet != tr.legs[1].is_singlet))
+            return true;
+        
+        for(const DiagramNode& leg : tr.legs){
+            if(leg.stays_zero())
+                return true;
+        }
+    }
+        
+    return false;
+}
+
 /**
  * @brief Recursively determines the flavour split of a diagram, and sets all
  * @c n_idcs members to the correct value.
@@ -260,7 +299,7 @@ void DiagramNode::label(std::vector<Propagator>& props, int n_idcs,
         if(tr.connected)
             //If prev is propagator leading to this node, then we must
             //invert it to make it ingoing!
-            prev = ((((mmask) 1) << n_idcs) - 1) ^ momenta;
+            prev = low_momenta(n_idcs) ^ momenta;
         else
             prev = tr.legs.back().momenta;
         
@@ -285,60 +324,48 @@ void DiagramNode::label(std::vector<Propagator>& props, int n_idcs,
 
 
 /**
- * @brief Recursively implements @link Diagram::extend @endlink.
+ * @brief Recursively implements @link Diagram::extension_sites @endlink.
  * 
- * @param diagrs    the list of diagrams to build up.
- * @param new_verts the list of vertices to be added.
+ * @param sites     the list of sites to build up.
  * @param idcs      the leg indices that, in some distinct labelling of the 
  *                  diagram, carries a flavour index that is a coset 
  *                  representative under @f$   Z_R @f$.
  *                  These are exactly the legs that should have vertices 
  *                  attached to them.
  *                  This information is determined by 
- *                  @link Diagram::extend @endlink.
+ *                  @link Diagram::extension_sites @endlink.
  * @param traversal defines a traversal of the tree. Each element is a 
  *                  (trace-idx, leg-idx) pair that defines which flavour 
  *                  trace and which leg should be visited at each level
  *                  in the tree to reach the current node. 
  *                  This information is passed on to 
  *                  @link Diagram::attach @endlink.
- * @param original  the diagram to be extended, and the diagram whose tree we 
- *                  are (hopefully) currently traversing.
  * @param singlet   enables extending with singlet propagators.
- * @param debug     enables debug printouts.
  * 
  * This method traverses the tree, recording its location with @p traversal, 
- * and visits all leaves whose indices are marked in @p idcs. For each such
- * leaf and for each new vertex, it calls @link Diagram::attach @endlink
- * to attach the vertex to the external leg.
+ * and visits all leaves whose indices are marked in @p idcs. Each such
+ * leaf is added to @p sites, together with whether singlet propagators may
+ * be attached to it.
  */
-void DiagramNode::extend(
-    std::vector<Diagram>& diagrs, const std::vector<vertex>& new_verts, 
-    std::unordered_set<int>& idcs, std::vector<std::pair<int, int> >& traversal, 
-    const Diagram& original, 
-    bool singlet, bool debug)
+void DiagramNode::extension_sites(
+    std::vector<site>& sites, const std::unordered_set<int>& idcs, 
+    std::vector<std::pair<int, int> >& traversal, bool singlet) const
 {
     if(is_leaf){
         int index = bitwise::unshift(momenta);
         
-        if(idcs.find(index) == idcs.end())
-            return;
-
-        for(vertex v : new_verts){           
-            original.attach(v, traversal, diagrs, 
-                    singlet && (v.first > 2), debug);
-        }
+        if(idcs.find(index) != idcs.end())
+            sites.push_back(site(traversal, singlet));
         
         return;
     }
     
     traversal.push_back(std::make_pair(0,0));
     
-    for(FlavourTrace& tr : traces){
-        for(DiagramNode& leg : tr.legs){
-            leg.extend(diagrs, new_verts, idcs, traversal, original, 
-                    singlet && (!leg.is_leaf || order > 2), debug
-            );
+    for(const FlavourTrace& tr : traces){
+        for(const DiagramNode& leg : tr.legs){
+            leg.extension_sites(sites, idcs, traversal, 
+                    singlet && (!leg.is_leaf || order > 2));
             traversal.back().second++;
         }
         traversal.back().first++;
@@ -379,3 +406,53 @@ void DiagramNode::attach(
             = DiagramNode(new_vert.first, new_vert.second, split_idx, singlet);
     }
 }
+
+/**
+ * @brief Recursively finds all vertices that are connected to the rest of the
+ * diagram by a single propagator.
+ * 
+ * @param verts         the vertices are added here.
+ * @param traversal     the location of this node, like in
+ *                      @link DiagramNode::extension_sites @endlink.
+ * @param parent_order  the order of the parent vertex.
+ * 
+ * A non-root vertex qualifies if all its children are external legs, and the
+ * root if exactly one of its children is not. Diagrams with a single vertex
+ * have none.
+ */
+void DiagramNode::leaf_vertices(
+    std::vector<LeafVertex>& verts, 
+    std::vector<std::pair<int, int> >& traversal, int parent_order) const 
+{
+    if(is_leaf)
+        return;
+    
+    const DiagramNode* inner = nullptr;
+    int n_inner = 0;
+    size_t inner_tr = 0;
+    for(size_t i = 0; i < traces.size(); i++){
+        for(size_t j = 0; j < traces[i].legs.size(); j++){
+            const DiagramNode& leg = traces[i].legs[j];
+            if(!leg.is_leaf){
+                inner = &leg;
+                inner_tr = i;
+                n_inner++;
+                
+                traversal.push_back(std::make_pair(i, j));
+                leg.leaf_vertices(verts, traversal, order);
+                traversal.pop_back();
+            }
+        }
+    }
+    
+    if(!is_root && n_inner == 0){
+        verts.push_back({momenta, order, n_legs + 1, 
+                (int) traces[connect_idx].legs.size() + 1, 
+                is_singlet, parent_order, traversal});
+    }
+    else if(is_root && n_inner == 1){
+        verts.push_back({(mmask) (momenta ^ inner->momenta), order, n_legs, 
+                (int) traces[inner_tr].legs.size(), 
+                inner->is_singlet, inner->order, traversal});
+    }
+}
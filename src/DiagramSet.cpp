@@ -0,0 +1,94 @@
+/*
+ * File:   DiagramSet.cpp
+ *
+ * Implements DiagramSet.hpp
+ */
+
+#include "DiagramSet.hpp"
+
+/**
+ * @brief Constructs an empty set.
+ *
+ * @param counting  if @c true, the diagrams are only kept as far as is needed
+ *                  to count them (see @link Diagram::strip @endlink), and
+ *                  identically zero ones are left out when released.
+ * @param n_shards  the number of independently locked parts, at least one.
+ */
+DiagramSet::DiagramSet(bool counting, size_t n_shards)
+: shards(), counting(counting), n_duplicates(0)
+{
+    for(size_t i = 0; i < std::max(n_shards, (size_t) 1); i++)
+        shards.push_back(std::unique_ptr<Shard>(new Shard()));
+}
+
+/**
+ * @brief Adds a diagram to the set, unless an equal diagram is present.
+ *
+ * @param d the diagram, which is moved into the set.
+ * @param r the rank of the diagram. If an equal diagram is present, the
+ *          one with the lower rank is kept.
+ * @return  @c true if no equal diagram was present.
+ *
+ * May be called concurrently from several threads.
+ */
+bool DiagramSet::insert(Diagram&& d, rank r){
+    size_t h = d.hash();
+    bool zero = d.is_zero();
+    if(counting)
+        d.strip();
+    
+    Shard& shard = *shards[h % shards.size()];
+    
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto range = shard.entries.equal_range(h);
+    for(auto it = range.first; it != range.second; ++it){
+        Entry& e = it->second;
+        if(e.diagr == d){
+            if(r < e.r)
+                e = Entry{std::move(d), r, zero};
+            n_duplicates++;
+            return false;
+        }
+    }
+    
+    shard.entries.insert(std::make_pair(h, Entry{std::move(d), r, zero}));
+    return true;
+}
+
+/**
+ * @brief Empties the set.
+ *
+ * @return  the diagrams that were in the set, sorted. If the set is 
+ *          counting, identically zero diagrams are left out, since they can
+ *          no longer be recognised once stripped.
+ *
+ * Must not be called while other threads are inserting.
+ */
+std::vector<Diagram> DiagramSet::release(){
+    auto diagrs = std::vector<Diagram>();
+    diagrs.reserve(size());
+    for(auto& shard : shards){
+        for(auto& h_entry : shard->entries){
+            if(!(counting && h_entry.second.zero))
+                diagrs.push_back(std::move(h_entry.second.diagr));
+        }
+        shard->entries.clear();
+    }
+    
+    std::sort(diagrs.begin(), diagrs.end());
+    return diagrs;
+}
+
+/**
+ * @brief Counts the diagrams in the set.
+ *
+ * @return  the number of distinct diagrams inserted.
+ *
+ * Must not be called while other threads are inserting.
+ */
+size_t DiagramSet::size() const {
+    size_t n = 0;
+    for(auto& shard : shards)
+        n += shard->entries.size();
+    return n;
+}
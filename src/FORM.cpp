@@ -419,12 +419,12 @@ void Diagram::diagram_name_FORM(std::ostream& form, int index) const {
  */
 void Propagator::FORM(std::ostream& form, mmask prop) const {    
     mmask one = (mmask) 1;
-    mmask nprop = normalise_mmask(prop, one << (n_mom - 1), (one << n_mom) - 1);
+    mmask nprop = normalise_mmask(prop, one << (n_mom - 1), low_momenta(n_mom));
     
     if(prop != nprop)
         form << "-(";
     bool first = true;
-    for(int i = 0; (one << i) < nprop && i < n_mom; i++){
+    for(int i = 0; i < n_mom && (one << i) < nprop; i++){
         if(nprop & (one << i)){
             if(!first)
                 form << "+";
@@ -0,0 +1,334 @@
+/*
+ * File:   FlatTree.cpp
+ *
+ * Implements FlatTree.hpp
+ */
+
+#include "FlatTree.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief Copies a tree into flat form.
+ *
+ * @param root the root of the tree.
+ *
+ * The copy has the same flavour split, indexing and momenta as @p root, so
+ * none of them needs to be redone unless the tree is changed.
+ */
+FlatTree::FlatTree(const DiagramNode& root)
+: nodes(1), traces(), root(0)
+{
+    flatten(0, root);
+}
+
+/**
+ * @brief Recursively copies a node into flat form.
+ *
+ * @param idx   the slot reserved for the node in @c nodes.
+ * @param node  the node.
+ *
+ * Slots are reserved for all legs of all traces before any of them is
+ * filled in, which keeps the legs of each trace adjacent.
+ */
+void FlatTree::flatten(uint32_t idx, const DiagramNode& node){
+    nodes[idx] = {node.momenta, node.order, node.n_legs, node.connect_idx,
+                  (uint32_t) traces.size(), (uint32_t) node.traces.size(),
+                  node.is_leaf, node.is_root, node.is_singlet};
+
+    uint32_t first = traces.size();
+    for(const DiagramNode::FlavourTrace& tr : node.traces){
+        traces.push_back({tr.momenta, tr.n_idcs, (uint32_t) nodes.size(),
+                          (uint32_t) tr.legs.size(), tr.connected});
+        nodes.resize(nodes.size() + tr.legs.size());
+    }
+
+    for(uint32_t t = 0; t < node.traces.size(); t++){
+        for(uint32_t l = 0; l < node.traces[t].legs.size(); l++)
+            flatten(traces[first + t].legs + l, node.traces[t].legs[l]);
+    }
+}
+
+/**
+ * @brief Implements @link DiagramNode::is_zero @endlink.
+ *
+ * @param idx the node.
+ * @return @c true if the diagram is zero based on the node or its
+ * descendants.
+ */
+bool FlatTree::is_zero(uint32_t idx) const {
+    const Node& node = nodes[idx];
+    if(node.is_leaf)
+        return false;
+
+    for(uint32_t t = node.traces; t < node.traces + node.n_traces; t++){
+        const Trace& tr = traces[t];
+        if(tr.connected && tr.n_legs == 1
+                && (node.is_singlet != nodes[tr.legs].is_singlet))
+            return true;
+        if(!tr.connected && tr.n_legs == 2
+                && (nodes[tr.legs].is_singlet != nodes[tr.legs+1].is_singlet))
+            return true;
+
+        for(uint32_t leg = tr.legs; leg < tr.legs + tr.n_legs; leg++){
+            if(is_zero(leg))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Determines the flavour split of the tree, and sets all @c n_idcs
+ * members to the correct value.
+ *
+ * @param flav_split    the sorted flavour split is put here, replacing its
+ *                      contents.
+ */
+void FlatTree::find_flav_split(std::vector<int>& flav_split){
+    flav_split.clear();
+    find_flav_split(root, flav_split);
+    std::sort(flav_split.begin(), flav_split.end());
+}
+
+/**
+ * @brief Implements @link DiagramNode::find_flav_split @endlink.
+ *
+ * @param idx           the node.
+ * @param flav_split    the (unsorted) flavour split that is built up.
+ * @return  the number of legs that are children of the node and that are in
+ *          the same flavour trace as its parent.
+ */
+int FlatTree::find_flav_split(uint32_t idx, std::vector<int>& flav_split){
+    if(nodes[idx].is_leaf)
+        return 1;
+
+    int con_sum = 0;
+    for(uint32_t t = nodes[idx].traces;
+            t < nodes[idx].traces + nodes[idx].n_traces; t++){
+        int sum = 0;
+        for(uint32_t leg = traces[t].legs;
+                leg < traces[t].legs + traces[t].n_legs; leg++){
+            if(nodes[leg].is_singlet){
+                int singlet_sum = find_flav_split(leg, flav_split);
+                if(singlet_sum > 0)
+                    flav_split.push_back(singlet_sum);
+            }
+            else
+                sum += find_flav_split(leg, flav_split);
+        }
+
+        traces[t].n_idcs = sum;
+
+        if(traces[t].connected)
+            con_sum = sum;
+        else if(sum > 0)
+            flav_split.push_back(sum);
+    }
+
+    return con_sum;
+}
+
+/**
+ * @brief Places flavour indices on the legs of the tree, like
+ * @link Diagram::index @endlink.
+ *
+ * @param flav_split the sorted flavour split of the tree.
+ */
+void FlatTree::index(const std::vector<int>& flav_split){
+    auto flav_split_idcs = std::list<std::pair<int, int>>();
+    int idx = 0;
+    for(int split : flav_split){
+        flav_split_idcs.push_back(std::make_pair(split, idx));
+        idx += split;
+    }
+
+    index(root, flav_split_idcs);
+}
+
+/**
+ * @brief Implements @link DiagramNode::index @endlink.
+ *
+ * @param idx               the node.
+ * @param flav_split_idcs   maps the size of a flavour split to the index at
+ *                          which its legs should start.
+ * @param flav_idx          the index of the current flavour split.
+ */
+int FlatTree::index(uint32_t idx,
+                    std::list<std::pair<int, int>>& flav_split_idcs,
+                    int flav_idx)
+{
+    if(nodes[idx].is_leaf){
+        nodes[idx].momenta = ((mmask) 1) << flav_idx;
+        return flav_idx + 1;
+    }
+
+    int sub_idx = -1;
+    for(uint32_t t = nodes[idx].traces;
+            t < nodes[idx].traces + nodes[idx].n_traces; t++){
+        const Trace& tr = traces[t];
+
+        if((!tr.connected || nodes[idx].is_singlet) && tr.n_idcs > 0){
+            auto it = flav_split_idcs.begin();
+            while((*it).first != tr.n_idcs){
+                ++it;
+                assert(it != flav_split_idcs.end());
+            }
+            sub_idx = (*it).second;
+            flav_split_idcs.erase(it);
+        }
+        else
+            sub_idx = flav_idx;
+
+        for(uint32_t leg = tr.legs; leg < tr.legs + tr.n_legs; leg++){
+            if(nodes[leg].is_singlet)
+                index(leg, flav_split_idcs);
+            else
+                sub_idx = index(leg, flav_split_idcs, sub_idx);
+
+            if(tr.connected)
+                flav_idx = sub_idx;
+        }
+    }
+
+    return flav_idx;
+}
+
+/**
+ * @brief Implements @link DiagramNode::set_momenta @endlink.
+ *
+ * @param idx the node.
+ * @return the momenta flowing from the node to its parent.
+ */
+mmask FlatTree::set_momenta(uint32_t idx){
+    if(nodes[idx].is_leaf)
+        return nodes[idx].momenta;
+
+    mmask momenta = 0;
+    for(uint32_t t = nodes[idx].traces;
+            t < nodes[idx].traces + nodes[idx].n_traces; t++){
+        mmask tr_momenta = 0;
+        for(uint32_t leg = traces[t].legs;
+                leg < traces[t].legs + traces[t].n_legs; leg++)
+            tr_momenta |= set_momenta(leg);
+
+        traces[t].momenta = tr_momenta;
+        momenta |= tr_momenta;
+    }
+
+    nodes[idx].momenta = momenta;
+    return momenta;
+}
+
+/**
+ * @brief Constructs the propagators of the identity labelling of the tree,
+ * like @link DiagramNode::label @endlink does for the root.
+ *
+ * @param props     the propagators are added here, unsorted.
+ * @param n_idcs    the total number of flavour indices on the tree.
+ */
+void FlatTree::label(std::vector<Propagator>& props, int n_idcs) const {
+    label(root, props, n_idcs, 0, 0);
+}
+
+/**
+ * @brief Implements @link DiagramNode::label @endlink.
+ *
+ * @param idx           the node.
+ * @param props         the list of propagators that is built up.
+ * @param n_idcs        the total number of flavour indices on the tree.
+ * @param parent_order  the order of the parent vertex.
+ * @param parent_prev   the leg of the parent vertex that comes immediately
+ *                      before the leg leading to this node.
+ */
+void FlatTree::label(uint32_t idx, std::vector<Propagator>& props,
+                     int n_idcs, int parent_order, mmask parent_prev) const
+{
+    const Node& node = nodes[idx];
+    if(node.is_leaf)
+        return;
+
+    for(uint32_t t = node.traces; t < node.traces + node.n_traces; t++){
+        const Trace& tr = traces[t];
+        mmask prev;
+        if(tr.connected)
+            prev = low_momenta(n_idcs) ^ node.momenta;
+        else
+            prev = nodes[tr.legs + tr.n_legs - 1].momenta;
+
+        for(uint32_t leg = tr.legs; leg < tr.legs + tr.n_legs; leg++){
+            label(leg, props, n_idcs, node.order, prev);
+            prev = nodes[leg].momenta;
+        }
+    }
+
+    if(!node.is_root && !node.is_singlet){
+        props.push_back(Propagator(node.momenta, n_idcs,
+                node.order,
+                parent_order));
+    }
+    else if(node.is_singlet){
+        const Trace& con = traces[node.traces + node.connect_idx];
+        mmask prev = nodes[con.legs + con.n_legs - 1].momenta;
+        props.push_back(Propagator(node.momenta, n_idcs,
+                node.order, prev,
+                parent_order, parent_prev));
+    }
+}
+
+/**
+ * @brief Removes a vertex that is connected to the rest of the tree by a
+ * single propagator.
+ *
+ * @param w the vertex, as found by @link DiagramNode::leaf_vertices
+ *          @endlink on the tree that this one was copied from.
+ *
+ * The vertex is replaced by an external leg. If it is the root, its
+ * neighbour becomes the new root. The tree is not indexed again, and its
+ * momenta are not set.
+ */
+void FlatTree::without(const DiagramNode::LeafVertex& w){
+    const Node leaf = {0, 0, 0, -1, 0, 0, true, false, false};
+
+    if(!w.where.empty()){
+        uint32_t idx = root;
+        for(auto& wd : w.where)
+            idx = traces[nodes[idx].traces + wd.first].legs + wd.second;
+        nodes[idx] = leaf;
+
+        return;
+    }
+
+    //The propagator to the old root is replaced by a leg, which comes last
+    //in the previously connected trace. The legs of that trace are moved to
+    //the end of the node array to make room for it.
+    for(uint32_t t = nodes[root].traces;
+            t < nodes[root].traces + nodes[root].n_traces; t++){
+        for(uint32_t leg = traces[t].legs;
+                leg < traces[t].legs + traces[t].n_legs; leg++){
+            if(nodes[leg].is_leaf)
+                continue;
+
+            Node& new_root = nodes[leg];
+            Trace& con = traces[new_root.traces + new_root.connect_idx];
+            new_root.n_legs++;
+            new_root.connect_idx = -1;
+            new_root.is_root = true;
+            new_root.is_singlet = false;
+
+            uint32_t first = nodes.size();
+            for(uint32_t l = con.legs; l < con.legs + con.n_legs; l++)
+                nodes.push_back(nodes[l]);
+            nodes.push_back(leaf);
+            con.legs = first;
+            con.n_legs++;
+            con.connected = false;
+
+            root = leg;
+            return;
+        }
+    }
+
+    assert(false);
+}
@@ -2,11 +2,14 @@
  * File:   Generator.cpp
  * Author: Mattias Sjo
  * 
- * Implements the group generators defined in Generator.h
+ * Implements the constructors and the ranking of the group generators
+ * defined in Generator.hpp
  * 
  * Created on 27 June 2019, 16:11
  */
 
+#include <algorithm>
+#include <cassert>
 #include <numeric>
 #include <vector>
 
@@ -14,14 +17,6 @@
 
 namespace permute{
     
-/**
- * @brief Base constructor: sets up the identity permutation.
- * @param n the size of the permutation.
- */
-Generator::Generator(int n)
-: done(false), perm(n) 
-{}
-
 /**
  * @brief Constructs a Generator for @f$   Z_n @f$.
  * @param n the value of @f$ n @f$.
@@ -30,24 +25,6 @@ Zn_Generator::Zn_Generator(int n)
 : Generator(n), n(n), count(0)
 {}
 
-/**
- * Pre-increments th cyclic permutation by cycling it one more step.
- * @return the updated generator. 
- */
-Zn_Generator& Zn_Generator::operator++(){
-    for(int i = 0; i < perm.size() - 1; i++)
-        perm.swap(i, i+1);
-    
-    if(++count >= n){
-        done = true;
-        count %= n;
-    }
-    else
-        done = false;
-    
-    return *this;
-}
-
 /**
  * Constructs a Generator for @f$ \\mathcal S_n @f$.
  * @param n the value of @f$ n @f$.
@@ -56,42 +33,6 @@ Sn_Generator::Sn_Generator(int n)
 : Generator(n), n(n), ctr_stack(n, 0), stack_idx(0)
 {}
 
-/**
- * @brief Visits the next permutation through the non-recursive version of 
- * Heap's algorithm.
- * 
- * Heap's algorithm visits all permutations of @f$ n @f$ elements exactly once and
- * moves to each new permutation by only exchanging two elements. The algorithm
- * is recursive in nature and generates all permutations of the first @f$ k-1 @f$
- * elements before touching the @f$ k @f$ th. Here, we emulate the recursion by
- * maintaining a stack of counters rather than recursively nested @c for loops. 
- * 
- * @return the updated generator.
- */
-Sn_Generator& Sn_Generator::operator++(){
-    stack_idx = 0;
-    while(stack_idx < n){
-        if(ctr_stack[stack_idx] < stack_idx){
-            if(stack_idx % 2)
-                perm.swap(ctr_stack[stack_idx], stack_idx);
-            else
-                perm.swap(0, stack_idx);
-            
-            ctr_stack[stack_idx]++;
-            
-            done = false;
-            return *this;
-        }
-        else{
-            ctr_stack[stack_idx] = 0;
-            stack_idx++;
-        }
-    }
-    
-    done = true;
-    return *this;    
-}
-
 /**
  * @brief Constructs a generator for @f$   Z_R @f$.
  * @param R @f$ R @f$, an ordered sequence of integers. If the sequence is not 
@@ -148,33 +89,180 @@ ZR_Generator::ZR_Generator(const std::initializer_list<int>& R)
 : ZR_Generator(std::vector<int>(R)) {}
 
 /**
- * @brief Visits the next permutation by updating the subcomponent groups in turn.
- * @return the updated generator.
+ * @brief Retrieves the order of the group.
+ * @return @f$ n @f$.
+ */
+size_t Zn_Generator::order() const {
+    return n;
+}
+
+/**
+ * @brief Retrieves the rank of the current permutation, i.e. the number of
+ * steps taken to it since the start of the traversal.
+ * @return the rank, below @link Zn_Generator::order order() @endlink.
+ */
+size_t Zn_Generator::rank() const {
+    return count;
+}
+
+/**
+ * @brief Moves to the permutation with a given rank.
+ * @param rank  the rank, below @link Zn_Generator::order order() @endlink.
  */
-ZR_Generator& ZR_Generator::operator++(){
+void Zn_Generator::seek(size_t rank){
+    assert(rank < order());
+    
+    auto map = std::vector<size_t>(n);
+    for(int i = 0; i < n; i++)
+        map[i] = (i + rank) % n;
+    
+    perm = Permutation(map.begin(), map.end());
+    count = rank;
     done = false;
+}
+
+/**
+ * @brief Retrieves the order of the group.
+ * @return @f$ n! @f$, or 0 if it does not fit in a @c size_t .
+ */
+size_t Sn_Generator::order() const {
+    size_t ord = 1;
+    for(int i = 2; i <= n; i++)
+        ord = order_product(ord, i);
     
-    //Cyclings first...
-    for(auto& c : cycl){
-        (*(c.first)).inverse().permute(perm, c.second);
-        if(++(c.first)){
-            (*(c.first)).permute(perm, c.second);
-            return *this;
-        }        
+    return ord;
+}
+
+/**
+ * @brief Retrieves the rank of the current permutation, i.e. the number of
+ * steps taken to it since the start of the traversal.
+ * @return the rank, below @link Sn_Generator::order order() @endlink,
+ *      which must not be 0.
+ * 
+ * The counters are the digits of the rank in the factorial number system:
+ * <tt> ctr_stack[i] </tt> is between 0 and @c i , and has weight @f$ i! @f$.
+ */
+size_t Sn_Generator::rank() const {
+    size_t r = 0;
+    for(int i = n; i-- > 0; )
+        r = r * (i + 1) + ctr_stack[i];
+    
+    return r;
+}
+
+/**
+ * @brief Moves to the permutation with a given rank.
+ * @param rank  the rank, below @link Sn_Generator::order order() @endlink,
+ *              which must not be 0.
+ * 
+ * The counters are set from the digits of the rank (see 
+ * @link Sn_Generator::rank @endlink), and the permutation is rebuilt by
+ * replaying the exchanges they count, most significant first. Each exchange
+ * of index @c i comes after a full traversal of the first @c i indices,
+ * which moves them the same way every time, so these moves are computed 
+ * once per index rather than replayed step by step.
+ */
+void Sn_Generator::seek(size_t rank){
+    assert(rank < order());
+    
+    for(int i = 0; i < n; i++){
+        ctr_stack[i] = rank % (i + 1);
+        rank /= i + 1;
     }
-    //...then swaps.
-    for(auto& s : swap){
-        (*(s.first)).inverse().permute(perm, s.second.first, s.second.second);
-        if(++(s.first)){
-            (*(s.first)).permute(perm, s.second.first, s.second.second);
-            return *this;
+    stack_idx = 0;
+    done = false;
+    
+    auto map = std::vector<int>(n);
+    //Moves the first moves.size() indices, taking the one at position p from
+    //position moves[p].
+    auto apply = [&map](const std::vector<int>& moves){
+        auto prev = std::vector<int>(map.begin(), map.begin() + moves.size());
+        for(size_t p = 0; p < moves.size(); p++)
+            map[p] = prev[moves[p]];
+    };
+    
+    //The moves made by a full traversal of the first i indices
+    auto trav = std::vector<std::vector<int>>(std::max(n, 2));
+    trav[1] = std::vector<int>(1, 0);
+    for(int i = 1; i + 1 < n; i++){
+        std::iota(map.begin(), map.begin() + i + 1, 0);
+        for(int j = 0; j < i; j++){
+            apply(trav[i]);
+            std::swap(map[i % 2 ? j : 0], map[i]);
         }
+        apply(trav[i]);
+        trav[i + 1] = std::vector<int>(map.begin(), map.begin() + i + 1);
     }
     
-    //Only if all subcomponents are done are we done.
-    done = true;
-    return *this;
+    std::iota(map.begin(), map.end(), 0);
+    for(int i = n - 1; i > 0; i--){
+        for(int j = 0; j < ctr_stack[i]; j++){
+            apply(trav[i]);
+            std::swap(map[i % 2 ? j : 0], map[i]);
+        }
+    }
+    
+    perm = Permutation(map.begin(), map.end());
 }
 
+/**
+ * @brief Retrieves the order of the group.
+ * @return the product of the orders of the subcomponent groups, or 0 if
+ *      it does not fit in a @c size_t .
+ */
+size_t ZR_Generator::order() const {
+    size_t ord = 1;
+    for(const auto& c : cycl)
+        ord = order_product(ord, c.first.order());
+    for(const auto& s : swap)
+        ord = order_product(ord, s.first.order());
+    
+    return ord;
+}
+
+/**
+ * @brief Retrieves the rank of the current permutation, i.e. the number of
+ * steps taken to it since the start of the traversal.
+ * @return the rank, below @link ZR_Generator::order order() @endlink,
+ *      which must not be 0.
+ */
+size_t ZR_Generator::rank() const {
+    size_t r = 0;
+    for(auto s = swap.rbegin(); s != swap.rend(); ++s)
+        r = r * s->first.order() + s->first.rank();
+    for(auto c = cycl.rbegin(); c != cycl.rend(); ++c)
+        r = r * c->first.order() + c->first.rank();
+    
+    return r;
+}
+
+/**
+ * @brief Moves to the permutation with a given rank.
+ * @param rank  the rank, below @link ZR_Generator::order order() @endlink,
+ *              which must not be 0.
+ * 
+ * The subcomponent groups are moved to the digits of the rank, and their 
+ * permutations are applied in the order in which stepping leaves them: 
+ * exchanges first, then cyclings.
+ */
+void ZR_Generator::seek(size_t rank){
+    assert(rank < order());
+    
+    for(auto& c : cycl){
+        c.first.seek(rank % c.first.order());
+        rank /= c.first.order();
+    }
+    for(auto& s : swap){
+        s.first.seek(rank % s.first.order());
+        rank /= s.first.order();
+    }
+    
+    perm = Permutation(perm.size());
+    for(const auto& s : swap)
+        (*(s.first)).permute(perm, s.second.first, s.second.second);
+    for(const auto& c : cycl)
+        (*(c.first)).permute(perm, c.second);
+    done = false;
+}
 
 }
@@ -27,6 +27,24 @@ Labelling::Labelling(DiagramNode& root, int n_legs)
     normalise();
 }
 
+/**
+ * @brief Labels a diagram whose momenta have already been set.
+ * 
+ * @param root the root node of the diagram.
+ * @param n_legs the number of legs on the diagram.
+ * @return the labelling given by the indexing of the diagram, which is the
+ *      same as that produced by the constructor, but leaves the diagram 
+ *      untouched.
+ */
+Labelling Labelling::identity(const DiagramNode& root, int n_legs){
+    Labelling lbl;
+    lbl.perm = permute::Permutation(n_legs);
+    root.label(lbl.props, n_legs);
+    lbl.normalise();
+    
+    return lbl;
+}
+
 /**
  * @brief Creates a permutation of a labelling.
  * 
@@ -36,12 +54,100 @@ Labelling::Labelling(DiagramNode& root, int n_legs)
 Labelling::Labelling(const Labelling& orig, const permute::Permutation& cycl)
 : perm(cycl), props() 
 {    
-    for(const Propagator& p : orig.props)
-        props.push_back(Propagator(p, cycl));
-    
+    orig.relabel(cycl, props);
+    normalise();
+}
+
+/**
+ * @brief Creates a labelling from its propagators.
+ * 
+ * @param perm  the permutation giving the labelling from the identity.
+ * @param props the propagators, in any order. They are moved into the 
+ *              labelling.
+ */
+Labelling::Labelling(const permute::Permutation& perm, 
+        std::vector<Propagator>&& props)
+: perm(perm), props(std::move(props))
+{
     normalise();
 }
 
+/**
+ * @brief Applies a permutation to the propagators of a labelling, without 
+ * making a new labelling of them.
+ * 
+ * @param cycl  the permutation.
+ * @param props the permuted propagators are put here, replacing its contents,
+ *              in no particular order. Together with @p cycl , they make up
+ *              the same labelling as <tt> Labelling(*this, cycl) </tt>.
+ */
+void Labelling::relabel(const permute::Permutation& cycl, 
+        std::vector<Propagator>& props) const 
+{
+    const permute::BitPermutation<mmask> bits(cycl);
+    props.clear();
+    props.reserve(this->props.size());
+    for(const Propagator& p : this->props)
+        props.push_back(Propagator(p, bits));
+}
+
+/**
+ * @brief Changes a labelling by rotating a block of indices.
+ * 
+ * @param offs  the first index in the block.
+ * @param len   the number of indices in the block.
+ * @param steps the number of steps by which each index in the block is 
+ *              increased, modulo the block. Less than @p len .
+ * 
+ * The result is the labelling given by the permutation of this one followed
+ * by the rotation. The propagators are rotated in place, which leaves all
+ * but those whose momenta straddle the block unchanged. The ones that 
+ * changed are then sorted back into position, which is linear in the number
+ * of propagators when few of them move.
+ */
+void Labelling::rotate(size_t offs, size_t len, size_t steps){
+    if(steps == 0)
+        return;
+    
+    permute::Permutation::index_type map[PERMUTE_CAPACITY];
+    size_t n = 0;
+    for(size_t i : perm)
+        map[n++] = (i >= offs && i < offs + len) 
+                   ? offs + (i - offs + steps) % len : i;
+    perm = permute::Permutation(map, map + n);
+    
+    for(Propagator& p : props)
+        p.rotate(offs, len, steps);
+    
+    //Insertion sort, which only does work for the propagators that moved
+    for(size_t i = 1; i < props.size(); i++){
+        for(size_t j = i; j > 0 && props[j] < props[j-1]; j--)
+            std::swap(props[j], props[j-1]);
+    }
+}
+
+/**
+ * @brief Checks whether a labelling has a given list of propagators.
+ * 
+ * @param props the propagators, in any order and without duplicates, as 
+ *              given by @link Labelling::relabel @endlink.
+ * @return @c true if the labelling equals one made of @p props . 
+ * 
+ * This does not need @p props to be sorted, since the propagators of the
+ * labelling are. Different propagators of a diagram carry different momenta,
+ * so relabelled propagators never need to be deduplicated.
+ */
+bool Labelling::has_props(const std::vector<Propagator>& props) const {
+    if(props.size() != this->props.size())
+        return false;
+    
+    for(const Propagator& p : props){
+        if(!std::binary_search(this->props.begin(), this->props.end(), p))
+            return false;
+    }
+    return true;
+}
+
 /**
  * @brief Normalises a labelling by lexicographically sorting its propagators.
  */
@@ -95,6 +201,24 @@ bool operator==(const Labelling& l1, const Labelling& l2){
     return l1.props == l2.props;
 }
 
+/**
+ * @brief Computes a hash value consistent with 
+ * @link operator==(const Labelling&, const Labelling&) operator== @endlink.
+ * 
+ * @param props   the propagators of a labelling, in any order.
+ * @return the hash value, which like the comparison ignores the permutation.
+ * 
+ * The hash is the sum of the hashes of the propagators, so it can be found
+ * for a list of propagators before they are sorted, and it changes by the 
+ * difference of their hashes when a propagator is replaced.
+ */
+size_t Labelling::hash(const std::vector<Propagator>& props){
+    size_t h = 0;
+    for(const Propagator& p : props)
+        h += p.hash();
+    return h;
+}
+
 /**
  * @brief Prints a summary of a labelling.
  * 
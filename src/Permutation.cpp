@@ -15,9 +15,9 @@ namespace permute{
  * @brief Generates the identity permutation.
  * @param size  the size of the permutation. Must be greater than zero.
  */
-Permutation::Permutation(size_t size) : map(size) {
-    assert(size > 0);
-    std::iota(map.begin(), map.end(), 0);
+Permutation::Permutation(size_t size) : len(size) {
+    assert(size > 0 && size <= PERMUTE_CAPACITY);
+    std::iota(map, map + len, 0);
 }
 
 /**
@@ -28,15 +28,10 @@ Permutation::Permutation(size_t size) : map(size) {
  * @link Permutation::is_permutation @endlink. No checks are made
  * here to verify that.
  */
-Permutation::Permutation(std::initializer_list<size_t> il) : map(il) 
+Permutation::Permutation(std::initializer_list<size_t> il) 
+: Permutation(il.begin(), il.end()) 
 {}
 
-/**
- * @brief Private conversion constructor.
- * @param perm  the internal representation of the permutation.
- */
-Permutation::Permutation(std::vector<size_t>& perm) : map(perm) {};
-
 /**
  * @brief Creates an identity permutation. 
  * 
@@ -57,12 +52,10 @@ Permutation Permutation::identity(size_t size){
  * @return  the cyclic permutation.
  */
 Permutation Permutation::cyclic(size_t size, size_t coffs){
-    assert(size > 0);
-    
-    auto perm = std::vector<size_t>(size);
+    Permutation perm(size);
     for(size_t i = 0; i < size; i++)
-        perm[i] = (i + coffs) % size;
-    return Permutation(perm);
+        perm.map[i] = (i + coffs) % size;
+    return perm;
 }
 
 /**
@@ -71,12 +64,9 @@ Permutation Permutation::cyclic(size_t size, size_t coffs){
  *          effect the original permutation had.
  */
 Permutation Permutation::reverse() const {
-    size_t s = size();
-    auto rev = std::vector<size_t>(s);
-    for(size_t i = 0; i < s; i++)
-        rev[i] = map[s - i - 1];
-    
-    return Permutation(rev);
+    Permutation rev(*this);
+    std::reverse(rev.map, rev.map + len);
+    return rev;
 }
 
 /**
@@ -85,12 +75,11 @@ Permutation Permutation::reverse() const {
  *          is the identity.
  */
 Permutation Permutation::inverse() const {
-    size_t s = size();
-    auto inv = std::vector<size_t>(s, 0);
-    for(size_t i = 0; i < s; i++)
-        inv[map[i]] = i;
+    Permutation inv(*this);
+    for(size_t i = 0; i < len; i++)
+        inv.map[map[i]] = i;
     
-    return Permutation(inv);
+    return inv;
 }
 
 /**
@@ -129,7 +118,7 @@ size_t Permutation::order() const {
  * @return @c true if and only if the permutation is the identity. 
  */
 bool Permutation::is_identity() const {
-    for(size_t i = 0; i < map.size(); i++)
+    for(size_t i = 0; i < len; i++)
         if(map[i] != i)
             return false;
     
@@ -175,7 +164,7 @@ int Permutation::parity() const {
 Permutation& Permutation::permute(
     Permutation& p, size_t offset, size_t block_len) const
 {
-    permute(p.map.begin(), offset, block_len);
+    permute(p.map, offset, block_len);
     return p;
 }
 
@@ -208,7 +197,7 @@ Permutation operator* (const Permutation& p1, const Permutation& p2){
     assert(p1.size() == p2.size());
     
     Permutation comp(p2);
-    p1.permute(comp.map.begin());
+    p1.permute(comp.map);
     
     return comp;
 }
@@ -227,7 +216,7 @@ Permutation operator* (const Permutation& p1, const Permutation& p2){
 Permutation& operator*= (Permutation& p1, const Permutation& p2){
     assert(p1.size() == p2.size());
     
-    p2.permute(p1.map.begin());
+    p2.permute(p1.map);
     
     return p1;
 }
@@ -301,7 +290,8 @@ Permutation operator% (const Permutation& p1, const Permutation& p2){
     Permutation comp;
     for(Permutation p(p2); !p.is_identity(); p *= p2){
         comp = p1 * p;
-        if(comp.map < least.map)
+        if(std::lexicographical_compare(comp.map, comp.map + comp.len,
+                                        least.map, least.map + least.len))
             least = comp;
     }
     
@@ -319,14 +309,14 @@ Permutation& operator%= (Permutation& p1, const Permutation& p2){
  * @brief Compares two permutations for equality.
  */
 bool operator== (const Permutation& p1, const Permutation& p2){
-    return p1.map == p2.map;
+    return p1.len == p2.len && std::equal(p1.map, p1.map + p1.len, p2.map);
 }
 
 /**
  * @brief Compares two permutations for inequality.
  */
 bool operator!= (const Permutation& p1, const Permutation& p2){
-    return p1.map != p2.map;
+    return !(p1 == p2);
 }
 
 /**
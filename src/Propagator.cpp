@@ -38,12 +38,9 @@ Propagator::Propagator(mmask momenta, int n_mom,
 Propagator::Propagator(mmask momenta, int n_mom,
             int src_order, mmask src_prev, 
             int dst_order, mmask dst_prev)
-: momenta(momenta), 
-        src_order(src_order), src_prev(src_prev), 
-        dst_order(dst_order), dst_prev(dst_prev), 
-        n_mom(n_mom)
+: n_mom(n_mom)
 {
-    normalise();
+    normalise(momenta, src_order, src_prev, dst_order, dst_prev);
 }
 
 /**
@@ -51,24 +48,75 @@ Propagator::Propagator(mmask momenta, int n_mom,
  * to the momentum indices of another propagator.
  * 
  * @param orig the original propagator.
- * @param cycl the permutaton, must have size equal to @c n_mom.
+ * @param cycl the permutaton, compiled for masks. Must have size equal to 
+ *             @c n_mom.
  * 
  * The resulting propagator will be normalised.
  */
 Propagator::Propagator(const Propagator& orig, 
-        const permute::Permutation& cycl) 
-: momenta(cycl.permute_bits(orig.momenta)), 
-        src_order(orig.src_order), src_prev(cycl.permute_bits(orig.src_prev)),
-        dst_order(orig.dst_order), dst_prev(cycl.permute_bits(orig.dst_prev)), 
-        n_mom(orig.n_mom)
+        const permute::BitPermutation<mmask>& cycl) 
+: n_mom(orig.n_mom)
 {
     assert(n_mom == cycl.size());
-    normalise();
+    normalise(cycl(orig.momenta()), 
+        orig.src_order(), cycl(orig.src_prev()),
+        orig.dst_order(), cycl(orig.dst_prev()));
 }
 
 /**
- * @brief Normalises a propagator so that all its momenta are in a 
- * canonical form under conservation of momentum.
+ * @brief Applies a rotation of a block of momentum indices to a propagator.
+ * 
+ * @param offs  the first index in the block.
+ * @param len   the number of indices in the block.
+ * @param steps the number of steps by which each index in the block is 
+ *              increased, modulo the block. Less than @p len .
+ * 
+ * This gives the same propagator as constructing one from this and the
+ * permutation that does the rotation, without building the permutation.
+ */
+void Propagator::rotate(size_t offs, size_t len, size_t steps){
+    normalise(bitwise::rotate(momenta(), offs, len, steps), 
+        src_order(), bitwise::rotate(src_prev(), offs, len, steps),
+        dst_order(), bitwise::rotate(dst_prev(), offs, len, steps));
+}
+
+/**
+ * @brief Stores the orders and masks of a propagator in its key.
+ * 
+ * @param momenta   the momenta it carries.
+ * @param src_order the source vertex order.
+ * @param src_prev  the momenta of the previous vertex leg at source.
+ * @param dst_order the destination vertex order.
+ * @param dst_prev  the momenta of the previous vertex leg at dest.
+ */
+void Propagator::pack(mmask momenta, int src_order, mmask src_prev, 
+        int dst_order, mmask dst_prev)
+{
+    assert(src_order >= 0 && src_order < 256);
+    assert(dst_order >= 0 && dst_order < 256);
+    
+    const mmask slots[N_SLOTS] = {
+        (mmask) ((src_order << 8) | dst_order), src_prev, dst_prev, momenta
+    };
+    
+    for(int w = 0; w < KEY_WORDS; w++)
+        key[w] = 0;
+    for(int s = 0; s < N_SLOTS; s++){
+        key[s / SLOTS_PER_WORD] |= ((key_word) slots[s]) 
+            << ((SLOTS_PER_WORD - 1 - s % SLOTS_PER_WORD) * FODGE_MMASK_BITS);
+    }
+}
+
+/**
+ * @brief Normalises the orders and masks of a propagator so that all its 
+ * momenta are in a canonical form under conservation of momentum, and stores
+ * them.
+ * 
+ * @param momenta   the momenta it carries.
+ * @param src_order the source vertex order.
+ * @param src_prev  the momenta of the previous vertex leg at source.
+ * @param dst_order the destination vertex order.
+ * @param dst_prev  the momenta of the previous vertex leg at dest.
  * 
  * By COM, a propagator carrying a set of momenta is equivalent to
  * a propagator carrying the complementary set of momenta going in
@@ -79,9 +127,11 @@ Propagator::Propagator(const Propagator& orig,
  * momenta, and if it contains exactly half the momenta, the one
  * not containing the momentum with the highest index is chosen.
  */
-void Propagator::normalise(){
-    mmask last_mask = 1 << (n_mom-1);
-    mmask all_mask = (1 << n_mom) - 1;
+void Propagator::normalise(mmask momenta, int src_order, mmask src_prev, 
+        int dst_order, mmask dst_prev)
+{
+    mmask last_mask = ((mmask) 1) << (n_mom-1);
+    mmask all_mask = low_momenta(n_mom);
     
     src_prev = normalise_mmask(src_prev, last_mask, all_mask);
     dst_prev = normalise_mmask(dst_prev, last_mask, all_mask);
@@ -92,6 +142,8 @@ void Propagator::normalise(){
         std::swap(src_prev, dst_prev);
         momenta = norm;
     }
+    
+    pack(momenta, src_order, src_prev, dst_order, dst_prev);
 }
 
 /**
@@ -119,20 +171,16 @@ const {
  * 
  * The comparison is rather arbitrary, as long as it is consistent.
  * It is done order before previous-leg momenta before propagator momenta,
- * source before destination.
+ * source before destination, which is the layout of the key.
  */
 bool operator<(const Propagator& p1, const Propagator& p2){
-
-    if(p1.src_order != p2.src_order)
-        return p1.src_order < p2.src_order;
-    if(p1.dst_order != p2.dst_order)
-        return p1.dst_order < p2.dst_order;
-    if(p1.src_prev != p2.src_prev)
-        return p1.src_prev < p2.src_prev;
-    if(p1.dst_prev != p2.dst_prev)
-        return p1.dst_prev < p2.dst_prev;
+    for(int w = 0; w < Propagator::KEY_WORDS - 1; w++){
+        if(p1.key[w] != p2.key[w])
+            return p1.key[w] < p2.key[w];
+    }
     
-    return p1.momenta < p2.momenta;
+    return p1.key[Propagator::KEY_WORDS - 1] 
+           < p2.key[Propagator::KEY_WORDS - 1];
 }
 
 
@@ -144,11 +192,29 @@ bool operator<(const Propagator& p1, const Propagator& p2){
  * @return @c true if and only if they are completely identical.
  */
 bool operator==(const Propagator& p1, const Propagator& p2){
-    return (p1.momenta == p2.momenta) 
-            && (p1.src_order == p2.src_order) 
-            && (p1.dst_order == p2.dst_order)
-            && (p1.src_prev == p2.src_prev)
-            && (p1.dst_prev == p2.dst_prev);
+    for(int w = 0; w < Propagator::KEY_WORDS; w++){
+        if(p1.key[w] != p2.key[w])
+            return false;
+    }
+    
+    return true;
+}
+
+/**
+ * @brief Computes a hash value consistent with 
+ * @link operator==(const Propagator&, const Propagator&) operator== @endlink.
+ * 
+ * @return the hash value, scrambled by @link mix_hash @endlink so that 
+ *      labellings can sum the hashes of their propagators.
+ */
+size_t Propagator::hash() const {
+    const int w = CHAR_BIT * sizeof(size_t);
+    size_t h = 0;
+    for(const key_word& k : key){
+        for(int i = 0; i < (int) (CHAR_BIT * sizeof(key_word)); i += w)
+            hash_combine(h, (size_t) (k >> i));
+    }
+    return mix_hash(h);
 }
 
 /**
@@ -164,23 +230,23 @@ bool operator==(const Propagator& p1, const Propagator& p2){
  * in brackets if needed.
  */
 std::ostream& operator<<(std::ostream& out, const Propagator& p){
-    bool print_prev = p.src_prev || p.dst_prev;
+    bool print_prev = p.src_prev() || p.dst_prev();
     
 #define HI_CHAR 'X'
 #define LO_CHAR '.'
     
-    bitwise::print_bits(p.momenta, p.n_mom, out, HI_CHAR, LO_CHAR);
+    bitwise::print_bits(p.momenta(), p.n_mom, out, HI_CHAR, LO_CHAR);
     
-    out << " (" << p.src_order;
+    out << " (" << p.src_order();
     if(print_prev){
         out << "[";
-        bitwise::print_bits(p.src_prev, p.n_mom, out, HI_CHAR, LO_CHAR);
+        bitwise::print_bits(p.src_prev(), p.n_mom, out, HI_CHAR, LO_CHAR);
         out << "]";
     }    
-    out << " -> " << p.dst_order;
+    out << " -> " << p.dst_order();
     if(print_prev){
         out << "[";
-        bitwise::print_bits(p.dst_prev, p.n_mom, out, HI_CHAR, LO_CHAR);
+        bitwise::print_bits(p.dst_prev(), p.n_mom, out, HI_CHAR, LO_CHAR);
         out << "]";
     }
     out << ")";
@@ -194,9 +260,9 @@ std::ostream& operator<<(std::ostream& out, const Propagator& p){
  * @param out the stream to which the header should be printed.
  */
 void Propagator::print_header(std::ostream& out) const {
-    bool print_prev = src_prev || dst_prev;
+    bool print_prev = src_prev() || dst_prev();
     int w = 0;
-    for(int ord = std::max(src_order, dst_order); ord > 0; ord /= 10, w++);
+    for(int ord = std::max(src_order(), dst_order()); ord > 0; ord /= 10, w++);
     
     for(int i = 0; i < n_mom; i++)
         out << (i % 10);
@@ -0,0 +1,138 @@
+/*
+ * File:   TaskPool.cpp
+ *
+ * Implements TaskPool.hpp
+ */
+
+#include "TaskPool.hpp"
+
+#include <thread>
+
+/** The pool whose worker is running on this thread, if any. */
+static thread_local TaskPool* current_pool = nullptr;
+/** The index of the worker running on this thread. */
+static thread_local size_t current_worker = 0;
+
+/**
+ * @brief Constructs a pool.
+ *
+ * @param n_threads the number of worker threads, at least one. No threads
+ *                  are started until @link TaskPool::run @endlink is called.
+ */
+TaskPool::TaskPool(int n_threads)
+: queues(), n_pending(0), n_steals(0), next_queue(0)
+{
+    for(int i = 0; i < std::max(n_threads, 1); i++)
+        queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+}
+
+/**
+ * @brief Adds a task to the pool.
+ *
+ * @param t the task.
+ *
+ * When called from a task running in this pool, the new task is put at the
+ * back of the calling worker's queue. Otherwise, tasks are dealt out to the
+ * workers in turn.
+ */
+void TaskPool::spawn(task t){
+    size_t worker;
+    if(current_pool == this)
+        worker = current_worker;
+    else
+        worker = (next_queue++) % queues.size();
+
+    n_pending++;
+
+    std::lock_guard<std::mutex> guard(queues[worker]->lock);
+    queues[worker]->tasks.push_back(std::move(t));
+}
+
+/**
+ * @brief Runs all tasks in the pool, and all tasks spawned by them.
+ *
+ * Returns when every task has finished. The calling thread acts as one of
+ * the workers.
+ */
+void TaskPool::run(){
+    n_steals = 0;
+
+    auto threads = std::vector<std::thread>();
+    for(size_t w = 1; w < queues.size(); w++)
+        threads.push_back(std::thread(&TaskPool::work, this, w));
+
+    work(0);
+
+    for(std::thread& t : threads)
+        t.join();
+}
+
+/**
+ * @brief Takes the newest task from a worker's own queue.
+ *
+ * @param worker    the worker.
+ * @param t         the task is put here.
+ * @return  @c true if a task was found.
+ */
+bool TaskPool::pop(size_t worker, task& t){
+    std::lock_guard<std::mutex> guard(queues[worker]->lock);
+    if(queues[worker]->tasks.empty())
+        return false;
+
+    t = std::move(queues[worker]->tasks.back());
+    queues[worker]->tasks.pop_back();
+    return true;
+}
+
+/**
+ * @brief Takes the oldest task from some other worker's queue.
+ *
+ * @param worker    the worker that is looking for work.
+ * @param t         the task is put here.
+ * @return  @c true if a task was found.
+ */
+bool TaskPool::steal(size_t worker, task& t){
+    for(size_t i = 1; i < queues.size(); i++){
+        TaskQueue& victim = *queues[(worker + i) % queues.size()];
+
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if(!victim.tasks.empty()){
+            t = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            n_steals++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief The main loop of a worker thread.
+ *
+ * @param worker    the index of the worker.
+ *
+ * A task is only counted as finished after it has returned, by which time
+ * all tasks it spawned are counted as pending. The pool is therefore
+ * only empty when no task remains anywhere.
+ */
+void TaskPool::work(size_t worker){
+    TaskPool* outer_pool = current_pool;
+    size_t outer_worker = current_worker;
+    current_pool = this;
+    current_worker = worker;
+
+    task t;
+    while(n_pending > 0){
+        if(pop(worker, t) || steal(worker, t)){
+            t();
+            t = nullptr;
+            n_pending--;
+        }
+        else
+            std::this_thread::yield();
+    }
+
+    current_pool = outer_pool;
+    current_worker = outer_worker;
+}
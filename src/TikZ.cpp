@@ -156,7 +156,7 @@ void Diagram::TikZ(std::ostream& tikz,
     if(draw_circle)
         tikz << "\t\\draw[black!30] (0,0) circle[radius=" << radius << "];\n";
     
-    auto points = std::unordered_map<mmask, Point>();
+    auto points = std::unordered_map<mmask, Point, mmask_hash>();
     int idx = 0;
     while(!root.def_TikZ(Point::circle(radius, n_legs), &idx, points));
     
@@ -218,7 +218,7 @@ void Diagram::TikZ(std::ostream& tikz,
  */
 bool DiagramNode::def_TikZ( 
         const std::vector<Point>& perimeter, int* idx,
-        std::unordered_map<mmask, Point>& points, mmask parent_key) const
+        std::unordered_map<mmask, Point, mmask_hash>& points, mmask parent_key) const
 {
     
     if(is_leaf){
@@ -315,7 +315,7 @@ bool DiagramNode::def_TikZ(
  * @todo fix this method if its error ever results in something bad.
  */
 void DiagramNode::adjust_TikZ(std::ostream& tikz,
-        std::unordered_map<mmask,Point>& points, 
+        std::unordered_map<mmask, Point, mmask_hash>& points, 
         double radius, mmask parent_key) const
 {
     if(is_leaf)
@@ -378,7 +378,7 @@ void DiagramNode::adjust_TikZ(std::ostream& tikz,
  *                  @p mid_angle should be compressed.
  */
 void DiagramNode::compress_points(
-        std::unordered_map<mmask,Point>& points, const Point& ref,
+        std::unordered_map<mmask, Point, mmask_hash>& points, const Point& ref,
         mmask key, mmask sub_key, bool incl_parent, 
         double mid_angle, double compression)
 {
@@ -465,7 +465,7 @@ Point DiagramNode::compress_point(const Point& ref, const Point& pt,
  * 
  * @todo choose weights that are less likely to be foiled by symmetric diagrams.
  */
-void Diagram::balance_points(std::unordered_map<mmask, Point>& pts)
+void Diagram::balance_points(std::unordered_map<mmask, Point, mmask_hash>& pts)
 {
     if(pts.size() < 2)
         return;
@@ -508,8 +508,8 @@ void Diagram::balance_points(std::unordered_map<mmask, Point>& pts)
 }
 
 
-#define ENCOMP_NAME(m) "p" << std::hex << m << std::dec
-#define INTSCT_NAME(m,n) "p" << std::hex << m << "x" << n << std::dec
+#define ENCOMP_NAME(m) "p" << mmask_hex(m)
+#define INTSCT_NAME(m,n) "p" << mmask_hex(m) << "x" << mmask_hex(n)
 
 /**
  * @brief Recursively draws a diagram using the points defined by
@@ -530,7 +530,7 @@ void Diagram::balance_points(std::unordered_map<mmask, Point>& pts)
  */
 Point DiagramNode::draw_TikZ(
         std::ostream& tikz,
-        const std::unordered_map<mmask, Point> points,
+        const std::unordered_map<mmask, Point, mmask_hash> points,
         mmask parent_key) const
 {
     if(is_leaf)
@@ -668,7 +668,7 @@ Point DiagramNode::draw_TikZ(
  */
 void DiagramNode::vertex_order_TikZ(
         std::ostream& tikz,
-        const std::unordered_map<mmask, Point> points,
+        const std::unordered_map<mmask, Point, mmask_hash> points,
         mmask parent_key) const
 {
     if(is_leaf || order == 2)
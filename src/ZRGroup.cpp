@@ -0,0 +1,108 @@
+/*
+ * File:   ZRGroup.cpp
+ *
+ * Implements ZRGroup.hpp
+ */
+
+#include "ZRGroup.hpp"
+#include "Generator.hpp"
+
+#include <numeric>
+
+struct ZRGroup::Entry {
+    Entry(const std::vector<int>& flav_split, const Entry* next)
+    : group(flav_split), next(next) {}
+    
+    const ZRGroup group;
+    const Entry* const next;
+};
+
+std::atomic<const ZRGroup::Entry*> ZRGroup::groups(nullptr);
+std::mutex ZRGroup::lock;
+
+/**
+ * @brief Looks up the group of a flavour split, building it the first time.
+ *
+ * @param flav_split    the sorted flavour split.
+ * @return  the group, which lives until the end of the process.
+ *
+ * May be called concurrently from several threads. Only building a group
+ * takes a lock.
+ */
+const ZRGroup& ZRGroup::of(const std::vector<int>& flav_split){
+    for(const Entry* e = groups.load(std::memory_order_acquire); e; e = e->next){
+        if(e->group.flav_split == flav_split)
+            return e->group;
+    }
+    
+    //Another thread may have built the group since the search began
+    std::lock_guard<std::mutex> guard(lock);
+    const Entry* first = groups.load(std::memory_order_relaxed);
+    for(const Entry* e = first; e; e = e->next){
+        if(e->group.flav_split == flav_split)
+            return e->group;
+    }
+    
+    const Entry* e = new Entry(flav_split, first);
+    groups.store(e, std::memory_order_release);
+    return e->group;
+}
+
+/**
+ * @brief Builds the group of a flavour split.
+ *
+ * @param flav_split the sorted flavour split.
+ */
+ZRGroup::ZRGroup(const std::vector<int>& flav_split)
+: flav_split(flav_split), n_idcs(0), offs(), rows(), gens(), zr_order(1)
+{
+    size_t n_tr = flav_split.size();
+    for(size_t t = 0, run = 1; t < n_tr; n_idcs += flav_split[t], t++){
+        offs.push_back(n_idcs);
+        rows.push_back((t > 0 && flav_split[t] == flav_split[t-1])
+                       ? rows[t-1] : t);
+
+        run = (t > 0 && flav_split[t] == flav_split[t-1]) ? run + 1 : 1;
+        zr_order = permute::order_product(zr_order, flav_split[t] * run);
+    }
+
+    auto map = std::vector<size_t>(n_idcs);
+    for(size_t t = 0; t < n_tr; t++){
+        int r = flav_split[t], idx = offs[t];
+        std::iota(map.begin(), map.end(), 0);
+
+        if(r > 1){
+            for(int i = 0; i < r; i++)
+                map[idx + i] = idx + (i + 1) % r;
+            gens.push_back(permute::Permutation(map.begin(), map.end()));
+            std::iota(map.begin(), map.end(), 0);
+        }
+        if(t + 1 < n_tr && flav_split[t + 1] == r){
+            for(int i = 0; i < r; i++)
+                std::swap(map[idx + i], map[idx + r + i]);
+            gens.push_back(permute::Permutation(map.begin(), map.end()));
+        }
+    }
+}
+
+/**
+ * @brief Builds an element of the group.
+ *
+ * @param dest  the trace that each trace is moved to. Traces may only be
+ *              moved to traces of the same length.
+ * @param rot   the number of steps that each trace is rotated by before it
+ *              is moved.
+ * @return  the element that rotates each trace @c t by <tt> rot[t] </tt>
+ *          steps and then moves it to where trace <tt> dest[t] </tt> is.
+ */
+permute::Permutation ZRGroup::element(const std::vector<size_t>& dest,
+                                      const std::vector<int>& rot) const
+{
+    permute::Permutation::index_type map[PERMUTE_CAPACITY];
+    for(size_t t = 0; t < offs.size(); t++){
+        for(int i = 0; i < flav_split[t]; i++)
+            map[offs[t] + i] = offs[dest[t]] + (i + rot[t]) % flav_split[t];
+    }
+
+    return permute::Permutation(map, map + n_idcs);
+}
@@ -11,9 +11,12 @@
 
 #include "fodge.hpp"
 #include "Diagram.hpp"
+#include "DiagramCache.hpp"
 #include "permute.hpp"
 
 #include <getopt.h>
+#include <unistd.h>
+#include <climits>
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
@@ -85,6 +88,48 @@ bool parse_flav_split(char* str, vector< vector<int> >& flav_splits){
 }
 
 
+/**
+ * @brief Hands a run over to the build of FODGE with the narrowest momentum 
+ * masks that fit the number of legs.
+ * 
+ * @param n_legs    the number of legs on the diagrams.
+ * @param argv      the command line input, which is passed on unchanged.
+ * 
+ * The builds are looked for next to the running executable, or on the 
+ * PATH if the location of the executable is not known; never in the 
+ * working directory unless that is where this build lives. If the 
+ * narrowest one that fits is missing, the next wider one is tried. Returns
+ * only if none of them could be started before reaching this build, which 
+ * should then do the run itself if it can.
+ */
+void dispatch_mask_width(int n_legs, char** argv){
+    static const pair<int, const char*> builds[] = {
+        {16, "fodge16"}, {32, "fodge"}, {64, "fodge64"}, {128, "fodge128"}
+    };
+    
+    char self[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    string dir = len > 0 ? string(self, len) : string(argv[0]);
+    //Invoked by bare name, so the build was found on the PATH
+    bool on_path = dir.find('/') == string::npos;
+    dir.erase(dir.rfind('/') + 1);
+    
+    for(const auto& build : builds){
+        if(build.first < n_legs)
+            continue;
+        if(build.first == FODGE_MMASK_BITS)
+            return;
+        
+        if(on_path){
+            execvp(build.second, argv);
+        }
+        else{
+            string path = dir + build.second;
+            execv(path.c_str(), argv);
+        }
+    }
+}
+
 /**
  * @brief Prints the help message.
  */
@@ -112,10 +157,32 @@ void print_help(){
             "                       interpreted as an argument to -O.       \n"
             " -N [--number-of-legs] Sets the number of legs on the diagrams.\n"
             "                       The second unnamed argument to fodge is \n"
-            "                       interpreted as an argument to -N.       \n"
+            "                       interpreted as an argument to -N. The   \n"
+            "                       run is handed on to the build of fodge  \n"
+            "                       with the narrowest momentum masks that  \n"
+            "                       fit: fodge16, fodge, fodge64 or fodge128\n"
+            "                       for up to 16, 32, 64 or 128 legs.       \n"
+            "                       (fodge16, fodge64 and fodge128 are only \n"
+            "                       built with -DFODGE_MASK_BUILDS=ON.)     \n"
             " -s [--singlets]       Enables U(1) singlet propagators. This  \n"
             "                       is the default mode.                    \n"
             " -S [--no-singlets]    Disables U(1) singlet propagators.      \n"
+            " -b [--bottom-up]      Generates all intermediate diagram sets \n"
+            "                       bottom-up, freeing each one as soon as  \n"
+            "                       it is no longer needed. This lowers the \n"
+            "                       peak memory usage for large runs.       \n"
+            " -g [--orderly]        Only keeps extensions that are          \n"
+            "                       canonical, so that most diagrams are    \n"
+            "                       built only once. The same diagrams are  \n"
+            "                       generated, with fewer duplicates along  \n"
+            "                       the way.                                \n"
+            " -j [--threads]        Extends diagrams using the given number \n"
+            "                       of threads. The result is the same as   \n"
+            "                       with a single thread (the default).     \n"
+            " -C [--cache-dir]      Stores all generated diagram sets in the\n"
+            "                       given (existing) directory, and reuses  \n"
+            "                       them in later runs instead of generating\n"
+            "                       them again.                             \n"
             " -i [--include-flav-split]     Removes all diagrams that do not\n"
             "                       have the specified flavour splits.      \n"
             "                       Flavour splits are entered as integers  \n"
@@ -128,6 +195,11 @@ void print_help(){
             "                       flavour splits.                         \n"
             " -l [--list-diagrams]  Gives a short summary table of the gene-\n"
             "                       rated diagrams.                         \n"
+            " -k [--count-only]     Generates the diagrams in full, but only\n"
+            "                       keeps what is needed to count them, and \n"
+            "                       prints the same summary table as -l.    \n"
+            "                       This saves memory but not time, and     \n"
+            "                       rules out -d, -t, -f and -b.            \n"
             " -d [--detailed-list]  Prints details about all generated dia- \n"
             "                       grams. All labellings are listed, each  \n"
             "                       described by a permutation followed by  \n"
@@ -139,7 +211,10 @@ void print_help(){
             "                       an O(p^a) vertex to an O(p^b) one. For  \n"
             "                       singlet propagators, the momentum of the\n"
             "                       adjacent vertex leg on each side is also\n"
-            "                       marked with X's.                        \n"
+            "                       marked with X's. The symmetry factor of \n"
+            "                       each diagram is the number of flavour   \n"
+            "                       permutations that leave its labellings  \n"
+            "                       unchanged.                              \n"
             " -f [--generate-form]  Generates three .hf files to the output \n"
             "                       directory. These can be used for ampli- \n"
             "                       tude calculations using FORM. Further   \n"
@@ -190,9 +265,12 @@ int main(int argc, char** argv) {
     double radius = 0;
     
     bool list = false, detailed = false, verbose = false;
+    bool bottom_up = false, orderly = false, count_only = false;
+    int n_threads = 1;
     
     string out_dir = "output/";
     string out_tag = ""; 
+    string cache_dir = "";
     
     bool singlets = true, incl_fsp = false;
     vector< vector<int> > flav_splits = vector< vector<int> >();
@@ -200,7 +278,7 @@ int main(int argc, char** argv) {
     // I opted for good ol' C-style getopt here 
     //rather than doing something fancy.
     opterr = 1;
-    const char* short_opts = "hN:O:tT:r:cfldvo:n:sSi:x:";
+    const char* short_opts = "hN:O:tT:r:cfldkvo:n:sSbgj:C:i:x:";
     struct option long_opts[] = {
         {"help",                no_argument,        0, 'h'},
         {"number-of-legs",      required_argument,  0, 'N'},
@@ -212,11 +290,16 @@ int main(int argc, char** argv) {
         {"draw-circle",         no_argument,        0, 'c'},
         {"list-diagrams",       no_argument,        0, 'l'},
         {"detailed-list",       no_argument,        0, 'd'},
+        {"count-only",          no_argument,        0, 'k'},
         {"verbose",             no_argument,        0, 'v'},
         {"output-dir",          required_argument,  0, 'o'},
         {"output-name",         required_argument,  0, 'n'},
         {"singlets",            no_argument,        0, 's'},
         {"no-singlets",         no_argument,        0, 'S'},
+        {"bottom-up",           no_argument,        0, 'b'},
+        {"orderly",             no_argument,        0, 'g'},
+        {"threads",             required_argument,  0, 'j'},
+        {"cache-dir",           required_argument,  0, 'C'},
         {"include-flav-split",  required_argument,  0, 'i'},
         {"exclude-flav-split",  required_argument,  0, 'x'},
         {0,0,0,0}
@@ -259,6 +342,8 @@ int main(int argc, char** argv) {
                 list = true;                break;
             case 'd':
                 detailed = true;            break;
+            case 'k':
+                count_only = true;          break;
             case 'v':
                 verbose = true;             break;
                 
@@ -271,6 +356,14 @@ int main(int argc, char** argv) {
                 singlets = true;            break;
             case 'S':
                 singlets = false;           break;
+            case 'b':
+                bottom_up = true;           break;
+            case 'g':
+                orderly = true;             break;
+            case 'j':
+                n_threads = atoi(optarg);   break;
+            case 'C':
+                cache_dir = string(optarg); break;
             case 'i':
                 incl_fsp = true;
                 //Intentional fall-through
@@ -307,6 +400,15 @@ int main(int argc, char** argv) {
         return 1;
     }
     
+    dispatch_mask_width(n_legs, argv);
+    if(n_legs > FODGE_MMASK_BITS){
+        cerr    << "ERROR: too many legs: " 
+                << n_legs << "\n\t(this build supports at most " 
+                << FODGE_MMASK_BITS << ")" 
+                << endl;
+        return 1;
+    }
+    
     if(order < 2 || order % 2){
         cerr    << "ERROR: invalid order: " 
                 << order << "\n\t(must be even and >= 2)" 
@@ -319,6 +421,19 @@ int main(int argc, char** argv) {
                 << endl;
         return 1;
     }
+    if(n_threads < 1){
+        cerr    << "ERROR: invalid number of threads: " << n_threads 
+                << "\n\t(must be a strictly positive integer)"
+                << endl;
+        return 1;
+    }
+    if(count_only && (detailed || gen_tikz || gen_form || bottom_up)){
+        cerr    << "ERROR: '--count-only' cannot be combined with "
+                << "'--detailed-list', '--generate-tikz', '--generate-form' "
+                << "or '--bottom-up'" 
+                << endl;
+        return 1;
+    }
     if(custom_radius && radius <= 0){
         cerr    << "ERROR: invalid tikz radius: " << radius 
                 << "\n\t(must be a strictly positive number)"
@@ -330,16 +445,32 @@ int main(int argc, char** argv) {
          << " --*-*-- FODGE version 2.0 --*-*--\n"
          << " --*-*-- Mattias Sjo, 2019 --*-*--\n";
          
+    DiagramCache::set_directory(cache_dir);
+    Diagram::set_threads(n_threads);
+    Diagram::set_orderly(orderly);
+    
     cout << "\nGenerating O(p^" << order << ") " << n_legs << "-point diagrams...\n";
-    auto diagrs = Diagram::generate(order, n_legs, singlets, true, verbose);
+    //The filter is applied during generation
+    Diagram::FlavSplitFilter filter = {flav_splits, incl_fsp};
+    const Diagram::FlavSplitFilter* fsp_filter 
+        = flav_splits.empty() ? nullptr : &filter;
+    
+    auto diagrs = count_only
+        ? Diagram::generate_stripped(order, n_legs, singlets, verbose, 
+                                     fsp_filter)
+        : bottom_up
+        ? Diagram::generate_bottom_up(order, n_legs, singlets, true, verbose, 
+                                      fsp_filter)
+        : Diagram::generate(order, n_legs, singlets, true, verbose, 
+                            fsp_filter);
         
     cout << "\n";
+    if(verbose && !bottom_up)
+        DiagramCache::report(cout << "\n");
     
-    //Implements filter
-    if(!flav_splits.empty()){
-        cout << Diagram::filter_flav_split(diagrs, flav_splits, incl_fsp)
-            << " diagrams removed by flavour split filter "
-            << (incl_fsp ? "(inclusive)" : "(exclsive)") << "\n\n";
+    if(fsp_filter){
+        cout << "Diagrams restricted by flavour split filter "
+            << (incl_fsp ? "(inclusive)" : "(exclusive)") << "\n\n";
     }
     
     //Prints details
@@ -374,7 +505,7 @@ int main(int argc, char** argv) {
     
     //Prints summary
     int n_singlets = 0;
-    if(list && !diagrs.empty())
+    if((list || count_only) && !diagrs.empty())
         n_singlets = Diagram::summarise(cout << "\n", diagrs);
     
     //Only default output: number of diagrams generated.
@@ -0,0 +1,64 @@
+/*
+ * File:   binary_test.cpp
+ *
+ * Checks that the sizes written by binary.hpp are read back, up to the
+ * largest size that can be written. Run by ctest.
+ */
+
+#include "binary.hpp"
+
+#include <sstream>
+
+/**
+ * @brief Prints a message if a check failed.
+ *
+ * @param ok    the result of the check.
+ * @param what  describes the check.
+ * @return @p ok
+ */
+bool check(bool ok, const char* what){
+    if(!ok)
+        std::cerr << "FAILED: " << what << std::endl;
+    return ok;
+}
+
+int main(){
+    bool ok = true;
+
+    //The largest size round-trips, and a smaller limit rejects it
+    {
+        std::stringstream buf;
+        binary::write_size(buf, binary::MAX_SIZE);
+        ok &= check(binary::read_size(buf, binary::MAX_SIZE) 
+                        == binary::MAX_SIZE && buf, 
+                    "read_size(MAX_SIZE)");
+
+        buf.clear();
+        buf.seekg(0);
+        ok &= check(binary::read_size(buf, 1 << 24) == 0 && !buf, 
+                    "read_size with a smaller limit");
+    }
+
+    //A count above the old default limit, as written for a large diagram
+    //set or a diagram with many labellings
+    {
+        auto vec = std::vector<uint8_t>((1 << 24) + 1);
+        for(size_t i = 0; i < vec.size(); i++)
+            vec[i] = (uint8_t) i;
+
+        std::stringstream buf;
+        binary::write(buf, vec);
+        auto read = std::vector<uint8_t>();
+        binary::read(buf, read);
+        ok &= check(buf && read == vec, "vector of (1 << 24) + 1 values");
+    }
+
+    //Sizes that do not fit are refused when writing
+    if(binary::MAX_SIZE < SIZE_MAX){
+        std::stringstream buf;
+        binary::write_size(buf, binary::MAX_SIZE + 1);
+        ok &= check(!buf && buf.str().empty(), "write_size(MAX_SIZE + 1)");
+    }
+
+    return ok ? 0 : 1;
+}